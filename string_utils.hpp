@@ -6,6 +6,31 @@
 // License: BSL-1.0
 // https://github.com/yurablok/cpp-string-utils
 // History:
+// v0.31 2026-Oct-16    Added `format_spec` for `to_string`.
+// v0.30 2026-Oct-16    Added `to_hex` and `from_hex`.
+// v0.29 2026-Oct-16    Added batch `from_string` for integers.
+// v0.28 2026-Oct-16    `from_string` parses integers 8 digits at a time without `<charconv>`.
+// v0.27 2026-Oct-16    `to_string` formats integers with a digit pair table without `<charconv>`.
+// v0.26 2026-Oct-16    Added `csv_index`.
+// v0.25 2026-Oct-16    Added `csv_writer`.
+// v0.24 2026-Oct-16    Added `csv_dialect` for `parseCSV` and `parseCSV_rows`.
+// v0.23 2026-Oct-16    Added `csv_columns`.
+// v0.22 2026-Oct-16    Added `parseCSV_rows`.
+// v0.21 2026-Oct-16    Added `csv_parser`.
+// v0.20 2026-Oct-16    Added `mapped_file`.
+// v0.19 2026-Oct-16    Added `parseCSV_parallel`.
+// v0.18 2026-Oct-16    `parseCSV` finds separators 64 bytes at a time with SIMD and PCLMULQDQ.
+// v0.17 2026-Oct-16    `parseCSV` passes cells as views of the input unless quotes split them.
+// v0.16 2026-Oct-16    Added `tokenizer`.
+// v0.15 2026-Oct-16    `trimm` scans 64 bytes at a time. Added `trimm_all`.
+// v0.14 2026-Oct-16    Added `split_parallel`.
+// v0.13 2026-Oct-16    Added `split_unescaped` and `bump_arena`.
+// v0.12 2026-Oct-16    Added `delimiter_sequence`.
+// v0.11 2026-Oct-16    Added `split_into` and `span`.
+// v0.10 2026-Oct-16    Added `split_view`.
+// v0.9 2026-Oct-16     Templated handlers and `function_ref` for `split` and `parseCSV`.
+// v0.8 2026-Oct-16     Added `delimiter_set`.
+// v0.7 2026-Oct-16     `split` and `substr` scan 64 bytes at a time with SSE2/AVX2.
 // v0.6 2023-Apr-26     Fixed build with clang-cl. Fixed `substr` [2].
 // v0.5 2023-Feb-14     Fixed `substr`.
 // v0.4 2023-Feb-09     Added `checked_string_view`.
@@ -20,6 +45,17 @@
 #include <string>
 #include <functional>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <array>
+#include <vector>
+#include <thread>
+#include <exception>
 
 #if defined(_MSVC_LANG) && _MSVC_LANG >= 201703L
 #   define CPP_STRING_UTILS_LIB_CHARCONV
@@ -63,6 +99,38 @@ inline std::string& operator+=(std::string& a, const std::string_view b) {
 #   include <cinttypes>
 #endif
 
+// Define `CPP_STRING_UTILS_NO_SIMD` to force the scalar code paths.
+#if !defined(CPP_STRING_UTILS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   define CPP_STRING_UTILS_SIMD_X86
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#   if defined(__GNUC__) || defined(__clang__)
+#       define CPP_STRING_UTILS_TARGET(features) __attribute__((target(features)))
+#   else
+#       define CPP_STRING_UTILS_TARGET(features)
+#   endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define CPP_STRING_UTILS_POSIX
+#   include <cerrno>
+#   include <fcntl.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+#include <cstdio>
+
+// Define `CPP_STRING_UTILS_NO_MMAP` to read files with buffered reads only.
+#if !defined(CPP_STRING_UTILS_NO_MMAP) && defined(CPP_STRING_UTILS_POSIX)
+#   define CPP_STRING_UTILS_MMAP
+#   include <sys/mman.h>
+#endif
+
 namespace utils {
 
 class checked_string_view : public std::string_view {
@@ -103,51 +171,771 @@ public:
     using std::string_view::operator=;
 };
 
-inline std::string_view trimm(checked_string_view string,
-        const checked_string_view by = std::string_view("\t\n\r \0", 5)) noexcept {
-    while (!string.empty()) {
-        if (by.find(string.front()) == std::string_view::npos) {
-            break;
+namespace detail {
+
+inline uint32_t ctz64(const uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    uint32_t index = 0;
+    while (((value >> index) & 1) == 0) {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+inline uint32_t popcount64(uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_popcountll(value));
+#else
+    value -= (value >> 1) & 0x5555555555555555ull;
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<uint32_t>((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline uint32_t bsr64(const uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    uint32_t index = 63;
+    while (((value >> index) & 1) == 0) {
+        --index;
+    }
+    return index;
+#endif
+}
+
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+
+enum cpu_feature : uint32_t {
+    cpu_avx2 = 1 << 0,
+    cpu_pclmul = 1 << 1,
+    cpu_ssse3 = 1 << 2,
+};
+
+inline uint32_t detect_cpu_features() noexcept {
+    uint32_t regs[4] = {};
+    const auto cpuid = [&regs](const uint32_t leaf) {
+#   if defined(_MSC_VER)
+        int r[4] = {};
+        __cpuidex(r, static_cast<int>(leaf), 0);
+        for (int i = 0; i < 4; ++i) {
+            regs[i] = static_cast<uint32_t>(r[i]);
         }
-        string = string.substr(1);
+#   else
+        __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#   endif
+    };
+    uint32_t features = 0;
+    cpuid(0);
+    const uint32_t maxLeaf = regs[0];
+    cpuid(1);
+    if ((regs[2] & (1u << 1)) != 0) {
+        features |= cpu_pclmul;
     }
-    while (!string.empty()) {
-        if (by.find(string.back()) == std::string_view::npos) {
-            break;
+    if ((regs[2] & (1u << 9)) != 0) {
+        features |= cpu_ssse3;
+    }
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    if (maxLeaf < 7 || !osxsave) {
+        return features;
+    }
+#   if defined(_MSC_VER) && !defined(__clang__)
+    const uint64_t xcr0 = _xgetbv(0);
+#   else
+    uint32_t xcr0lo = 0;
+    uint32_t xcr0hi = 0;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+    const uint64_t xcr0 = (static_cast<uint64_t>(xcr0hi) << 32) | xcr0lo;
+#   endif
+    cpuid(7);
+    if ((xcr0 & 6) == 6 && (regs[1] & (1u << 5)) != 0) {
+        features |= cpu_avx2;
+    }
+    return features;
+}
+
+inline uint32_t cpu_features() noexcept {
+    static const uint32_t features = detect_cpu_features();
+    return features;
+}
+
+#endif // CPP_STRING_UTILS_SIMD_X86
+
+inline bool has_avx2() noexcept {
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    return (cpu_features() & cpu_avx2) != 0;
+#else
+    return false;
+#endif
+}
+
+inline bool has_pclmul() noexcept {
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    return (cpu_features() & cpu_pclmul) != 0;
+#else
+    return false;
+#endif
+}
+
+inline bool has_ssse3() noexcept {
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    return (cpu_features() & cpu_ssse3) != 0;
+#else
+    return false;
+#endif
+}
+
+struct classify64;
+
+} // namespace detail
+
+// Precomputed set of single-byte delimiters. Build it once (e.g. as a `constexpr`
+// object in C++17) and share it between calls and threads.
+class delimiter_set {
+public:
+    _CONSTEXPR17 delimiter_set() noexcept {}
+    // Takes all bytes of a string literal, so "\t\n\r \0" includes the NUL.
+    template<size_t size>
+    _CONSTEXPR17 explicit delimiter_set(const char (&set)[size]) noexcept
+        : delimiter_set(set, size - 1) {}
+    _CONSTEXPR17 delimiter_set(const char* set, const size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            insert(set[i]);
+        }
+    }
+    explicit delimiter_set(const checked_string_view set) noexcept
+        : delimiter_set(set.data(), set.size()) {}
+
+    _CONSTEXPR17 bool contains(const char c) const noexcept {
+        const uint8_t u = static_cast<uint8_t>(c);
+        return ((m_bits[u >> 6] >> (u & 63)) & 1) != 0;
+    }
+    _CONSTEXPR17 bool empty() const noexcept {
+        return m_count == 0;
+    }
+
+private:
+    friend struct detail::classify64;
+    static constexpr uint32_t max_chars = 8;
+
+    _CONSTEXPR17 void insert(const char c) noexcept {
+        if (contains(c)) {
+            return;
         }
-        string = string.substr(0, string.size() - 1);
+        const uint8_t u = static_cast<uint8_t>(c);
+        m_bits[u >> 6] |= uint64_t(1) << (u & 63);
+        m_nibbles[(u >> 7) * 16 + (u & 0x0F)] |= static_cast<uint8_t>(1 << ((u >> 4) & 7));
+        if (u >= 0x80) {
+            m_ascii = false;
+        }
+        if (m_count < max_chars) {
+            m_chars[m_count] = c;
+        }
+        if (m_count <= max_chars) {
+            ++m_count;
+        }
+    }
+
+    uint64_t m_bits[4] = {};
+    // Per low nibble, a bitmask of the high nibbles present: [0, 16) for bytes
+    // below 0x80, [16, 32) for the rest. Consumed by the `pshufb` lookup.
+    uint8_t m_nibbles[32] = {};
+    char m_chars[max_chars] = {};
+    // Number of distinct `m_chars` or `max_chars + 1` when there are more.
+    uint32_t m_count = 0;
+    bool m_ascii = true;
+};
+
+// Multi-byte delimiter such as "\r\n" or " -> ", matched as a whole. It refers to
+// the bytes it was built from, so they must outlive it. When it starts with the
+// escape char, e.g. "\\x" with the default '\\', nothing is escaped while it is
+// being matched.
+class delimiter_sequence {
+public:
+    _CONSTEXPR17 delimiter_sequence() noexcept {}
+    template<size_t size>
+    _CONSTEXPR17 explicit delimiter_sequence(const char (&sequence)[size]) noexcept
+        : m_sequence(sequence, size - 1) {}
+    explicit delimiter_sequence(const checked_string_view sequence) noexcept
+        : m_sequence(sequence) {}
+
+    _CONSTEXPR17 std::string_view view() const noexcept {
+        return m_sequence;
+    }
+    _CONSTEXPR17 size_t size() const noexcept {
+        return m_sequence.size();
+    }
+    _CONSTEXPR17 bool empty() const noexcept {
+        return m_sequence.empty();
+    }
+
+private:
+    std::string_view m_sequence;
+};
+
+// Result of `split_into`: the number of parts written and the input left
+// after the delimiter that ended the last of them.
+struct split_result {
+    size_t count;
+    std::string_view rest;
+};
+
+// Bump allocator over caller-provided memory. `reset` makes all of it available again.
+class bump_arena {
+public:
+    _CONSTEXPR17 bump_arena() noexcept {}
+    _CONSTEXPR17 bump_arena(char* data, const size_t size) noexcept
+        : m_data(data), m_size(size) {}
+    template<size_t size>
+    _CONSTEXPR17 bump_arena(char (&buffer)[size]) noexcept
+        : m_data(buffer), m_size(size) {}
+    explicit bump_arena(std::string& buffer) noexcept
+        : m_data(&buffer[0]), m_size(buffer.size()) {}
+
+    // Returns `nullptr` when less than `size` bytes are left.
+    inline char* allocate(const size_t size) noexcept {
+        if (m_size - m_used < size) {
+            return nullptr;
+        }
+        char* ptr = m_data + m_used;
+        m_used += size;
+        return ptr;
+    }
+    // Gives back the unused tail of the last allocation of `size` bytes.
+    inline void shrink_last(const size_t size, const size_t used) noexcept {
+        m_used -= size - used;
+    }
+    inline void reset() noexcept {
+        m_used = 0;
+    }
+    _CONSTEXPR17 size_t used() const noexcept {
+        return m_used;
+    }
+    _CONSTEXPR17 size_t capacity() const noexcept {
+        return m_size;
+    }
+
+private:
+    char* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_used = 0;
+};
+
+namespace detail {
+
+// Classifies 64 bytes at `p`: bit N of `delims` is set when `p[N]` belongs to `set`,
+// bit N of `escapes` is set when `p[N] == escape`.
+struct classify64 {
+    static void scalar(const char* p, const delimiter_set& set, const char escape,
+            uint64_t& delims, uint64_t& escapes) noexcept {
+        delims = 0;
+        escapes = 0;
+        for (uint32_t i = 0; i < 64; ++i) {
+            delims |= uint64_t(set.contains(p[i])) << i;
+            escapes |= uint64_t(p[i] == escape) << i;
+        }
+    }
+
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+
+    static void sse2(const char* p, const delimiter_set& set, const char escape,
+            uint64_t& delims, uint64_t& escapes) noexcept {
+        if (set.m_count > delimiter_set::max_chars) {
+            scalar(p, set, escape, delims, escapes);
+            return;
+        }
+        const __m128i esc = _mm_set1_epi8(escape);
+        delims = 0;
+        escapes = 0;
+        for (uint32_t i = 0; i < 64; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            __m128i acc = _mm_setzero_si128();
+            for (uint32_t c = 0; c < set.m_count; ++c) {
+                acc = _mm_or_si128(acc, _mm_cmpeq_epi8(v, _mm_set1_epi8(set.m_chars[c])));
+            }
+            delims |= static_cast<uint64_t>(
+                static_cast<uint16_t>(_mm_movemask_epi8(acc))) << i;
+            escapes |= static_cast<uint64_t>(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, esc)))) << i;
+        }
+    }
+
+    CPP_STRING_UTILS_TARGET("avx2")
+    static void avx2(const char* p, const delimiter_set& set, const char escape,
+            uint64_t& delims, uint64_t& escapes) noexcept {
+        const __m256i esc = _mm256_set1_epi8(escape);
+        delims = 0;
+        escapes = 0;
+        if (set.m_count <= 3) {
+            for (uint32_t i = 0; i < 64; i += 32) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                __m256i acc = _mm256_setzero_si256();
+                for (uint32_t c = 0; c < set.m_count; ++c) {
+                    acc = _mm256_or_si256(acc,
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(set.m_chars[c])));
+                }
+                delims |= static_cast<uint64_t>(
+                    static_cast<uint32_t>(_mm256_movemask_epi8(acc))) << i;
+                escapes |= static_cast<uint64_t>(static_cast<uint32_t>(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, esc)))) << i;
+            }
+            return;
+        }
+        // Nibble lookup: a byte is a member when the bit of its high nibble is set
+        // in the mask looked up by its low nibble.
+        const __m256i lowNibbles = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.m_nibbles)));
+        const __m256i highNibbles = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.m_nibbles + 16)));
+        const __m256i bitOfHigh = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+        for (uint32_t i = 0; i < 64; i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            const __m256i lo = _mm256_and_si256(v, nibbleMask);
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibbleMask);
+            // `bitOfHigh` maps both halves of the high nibble range to one bit.
+            const __m256i bit = _mm256_shuffle_epi8(bitOfHigh, hi);
+            __m256i hits = _mm256_and_si256(_mm256_shuffle_epi8(lowNibbles, lo), bit);
+            if (!set.m_ascii) {
+                const __m256i isHigh = _mm256_cmpgt_epi8(_mm256_setzero_si256(), v);
+                hits = _mm256_blendv_epi8(hits,
+                    _mm256_and_si256(_mm256_shuffle_epi8(highNibbles, lo), bit), isHigh);
+            }
+            else {
+                hits = _mm256_andnot_si256(_mm256_cmpgt_epi8(_mm256_setzero_si256(), v), hits);
+            }
+            const __m256i members = _mm256_cmpeq_epi8(hits, _mm256_setzero_si256());
+            delims |= static_cast<uint64_t>(
+                ~static_cast<uint32_t>(_mm256_movemask_epi8(members))) << i;
+            escapes |= static_cast<uint64_t>(static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, esc)))) << i;
+        }
+    }
+
+#endif // CPP_STRING_UTILS_SIMD_X86
+};
+
+// `classify64` for the first `size` bytes at `p`, at most 64; bits past `size` are 0.
+inline void classify(const char* p, const size_t size, const delimiter_set& set,
+        const char escape, const bool avx2, uint64_t& delims, uint64_t& escapes) noexcept {
+    char tail[64];
+    if (size < 64) {
+        std::memset(tail, 0, sizeof(tail));
+        std::memcpy(tail, p, size);
+        p = tail;
+    }
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    if (avx2) {
+        classify64::avx2(p, set, escape, delims, escapes);
+    }
+    else {
+        classify64::sse2(p, set, escape, delims, escapes);
+    }
+#else
+    (void)avx2;
+    classify64::scalar(p, set, escape, delims, escapes);
+#endif
+    if (size < 64) {
+        const uint64_t valid = (uint64_t(1) << size) - 1;
+        delims &= valid;
+        escapes &= valid;
     }
-    return string;
 }
 
-inline void split(const checked_string_view str, const checked_string_view by,
-        const std::function<void(std::string_view part, uint32_t idx)> handler,
-        const bool withEmpty = false, const char escape = '\\') noexcept {
-    if (by.empty() || !handler) {
-        return;
+// Position of the first byte in [begin, end) not in `set`, or `end`. Short runs
+// are checked byte by byte; longer ones 64 bytes at a time, reading whole blocks
+// of `str` where it is long enough to avoid copying a partial one.
+inline size_t find_first_not_of(const std::string_view str, size_t begin, const size_t end,
+        const delimiter_set& set, const bool avx2) noexcept {
+    for (const size_t limit = end - begin < 8 ? end : begin + 8; begin < limit; ++begin) {
+        if (!set.contains(str[begin])) {
+            return begin;
+        }
     }
-    size_t begin = 0;
-    bool isPrevEscape = false;
-    uint32_t idx = 0;
-    for (size_t i = 0; i < str.size(); ++i) {
-        if (!isPrevEscape) {
-            if (str[i] == escape) {
-                isPrevEscape = true;
+    while (begin < end) {
+        const size_t size = end - begin < 64 ? end - begin : 64;
+        uint64_t delims = 0;
+        uint64_t escapes = 0;
+        classify(str.data() + begin, str.size() - begin, set, 0, avx2, delims, escapes);
+        uint64_t others = ~delims;
+        if (size < 64) {
+            others &= (uint64_t(1) << size) - 1;
+        }
+        if (others != 0) {
+            return begin + ctz64(others);
+        }
+        begin += size;
+    }
+    return end;
+}
+
+// One past the last byte in [begin, end) not in `set`, or `begin`.
+inline size_t find_last_not_of(const std::string_view str, const size_t begin, size_t end,
+        const delimiter_set& set, const bool avx2) noexcept {
+    for (const size_t limit = end - begin < 8 ? begin : end - 8; end > limit; --end) {
+        if (!set.contains(str[end - 1])) {
+            return end;
+        }
+    }
+    while (end > begin) {
+        const size_t size = end - begin < 64 ? end - begin : 64;
+        const size_t from = end < 64 ? 0 : end - 64;
+        uint64_t delims = 0;
+        uint64_t escapes = 0;
+        classify(str.data() + from, end - from, set, 0, avx2, delims, escapes);
+        // Bits of [end - size, end) relative to `from`.
+        uint64_t others = ~delims >> (end - from - size);
+        if (size < 64) {
+            others &= (uint64_t(1) << size) - 1;
+        }
+        if (others != 0) {
+            return end - size + bsr64(others) + 1;
+        }
+        end -= size;
+    }
+    return begin;
+}
+
+inline const delimiter_set& whitespace() noexcept {
+    static const delimiter_set set("\t\n\r \0");
+    return set;
+}
+
+// Returns the bytes escaped by an odd run of preceding `escapes`. `carry` is 1 when
+// the first byte of the block is escaped and receives the same for the next block.
+inline uint64_t escaped_mask(const uint64_t escapes, uint64_t& carry) noexcept {
+    if (escapes == 0) {
+        const uint64_t escaped = carry;
+        carry = 0;
+        return escaped;
+    }
+    constexpr uint64_t oddBits = 0xAAAAAAAAAAAAAAAAull;
+    const uint64_t potential = escapes & ~carry;
+    const uint64_t code = (((potential << 1) | oddBits) - potential) ^ oddBits;
+    const uint64_t escaped = code ^ (escapes | carry);
+    carry = (code & escapes) >> 63;
+    return escaped;
+}
+
+// Yields positions of unescaped delimiters from `pos` onwards, 64 bytes at a time.
+class delimiter_scanner {
+public:
+    delimiter_scanner() noexcept {}
+    // `escaped` tells that the byte at `pos` is escaped by the bytes before it.
+    delimiter_scanner(const std::string_view str, const size_t pos,
+            const delimiter_set& set, const char escape, const bool escaped = false) noexcept
+        : m_str(str), m_set(&set), m_block(pos), m_carry(escaped ? 1 : 0), m_escape(escape),
+          m_avx2(has_avx2()) {
+        if (m_block < m_str.size()) {
+            load();
+        }
+    }
+
+    size_t delimiter_size() const noexcept {
+        return 1;
+    }
+
+    // Points the scanner at a copy of its set, e.g. after copying the owner of both.
+    void rebind(const delimiter_set& set) noexcept {
+        m_set = &set;
+    }
+
+    // Whether [begin, end) holds an escape char. `end` must not be past the
+    // last position returned by `next`.
+    bool has_escape(const size_t begin, const size_t end) const noexcept {
+        if (end > m_block && m_escapes != 0) {
+            const size_t from = begin > m_block ? begin - m_block : 0;
+            const size_t to = end - m_block;
+            uint64_t bits = m_escapes >> from;
+            if (to - from < 64) {
+                bits &= (uint64_t(1) << (to - from)) - 1;
+            }
+            if (bits != 0) {
+                return true;
+            }
+        }
+        return begin < m_block && m_lastEscape != std::string_view::npos
+            && m_lastEscape >= begin;
+    }
+
+    // Returns the position of the next delimiter or `npos`.
+    size_t next() noexcept {
+        while (m_delims == 0) {
+            if (m_escapes != 0) {
+                m_lastEscape = m_block + bsr64(m_escapes);
+                m_escapes = 0;
+            }
+            m_block += 64;
+            if (m_block >= m_str.size()) {
+                m_block = m_str.size();
+                return std::string_view::npos;
+            }
+            load();
+        }
+        const size_t pos = m_block + ctz64(m_delims);
+        m_delims &= m_delims - 1;
+        return pos;
+    }
+
+private:
+    void load() noexcept {
+        uint64_t delims = 0;
+        uint64_t escapes = 0;
+        classify(m_str.data() + m_block, m_str.size() - m_block, *m_set, m_escape,
+            m_avx2, delims, escapes);
+        const uint64_t escaped = escaped_mask(escapes, m_carry);
+        m_delims = delims & ~escapes & ~escaped;
+        m_escapes = escapes;
+    }
+
+    std::string_view m_str;
+    const delimiter_set* m_set = nullptr;
+    size_t m_block = 0;
+    uint64_t m_carry = 0;
+    size_t m_lastEscape = std::string_view::npos;
+    uint64_t m_delims = 0;
+    uint64_t m_escapes = 0;
+    char m_escape = 0;
+    bool m_avx2 = false;
+};
+
+// Finds candidate positions of a delimiter sequence in 64 bytes at `p`: bit N of
+// `candidates` is set when `p[N] == first` and `p[N + lastOffset] == last`,
+// bit N of `escapes` when `p[N] == escape`. Reads `64 + lastOffset` bytes.
+struct match64 {
+    static void scalar(const char* p, const size_t size, const char first, const char last,
+            const size_t lastOffset, const char escape,
+            uint64_t& candidates, uint64_t& escapes) noexcept {
+        candidates = 0;
+        escapes = 0;
+        const size_t count = size < 64 ? size : 64;
+        for (size_t i = 0; i < count; ++i) {
+            if (p[i] == first && i + lastOffset < size && p[i + lastOffset] == last) {
+                candidates |= uint64_t(1) << i;
+            }
+            escapes |= uint64_t(p[i] == escape) << i;
+        }
+    }
+
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+
+    static void sse2(const char* p, const char first, const char last,
+            const size_t lastOffset, const char escape,
+            uint64_t& candidates, uint64_t& escapes) noexcept {
+        const __m128i f = _mm_set1_epi8(first);
+        const __m128i l = _mm_set1_epi8(last);
+        const __m128i e = _mm_set1_epi8(escape);
+        candidates = 0;
+        escapes = 0;
+        for (uint32_t i = 0; i < 64; i += 16) {
+            const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const __m128i tail = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(p + i + lastOffset));
+            const __m128i hits = _mm_and_si128(
+                _mm_cmpeq_epi8(head, f), _mm_cmpeq_epi8(tail, l));
+            candidates |= static_cast<uint64_t>(
+                static_cast<uint16_t>(_mm_movemask_epi8(hits))) << i;
+            escapes |= static_cast<uint64_t>(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(head, e)))) << i;
+        }
+    }
+
+    CPP_STRING_UTILS_TARGET("avx2")
+    static void avx2(const char* p, const char first, const char last,
+            const size_t lastOffset, const char escape,
+            uint64_t& candidates, uint64_t& escapes) noexcept {
+        const __m256i f = _mm256_set1_epi8(first);
+        const __m256i l = _mm256_set1_epi8(last);
+        const __m256i e = _mm256_set1_epi8(escape);
+        candidates = 0;
+        escapes = 0;
+        for (uint32_t i = 0; i < 64; i += 32) {
+            const __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            const __m256i tail = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(p + i + lastOffset));
+            const __m256i hits = _mm256_and_si256(
+                _mm256_cmpeq_epi8(head, f), _mm256_cmpeq_epi8(tail, l));
+            candidates |= static_cast<uint64_t>(
+                static_cast<uint32_t>(_mm256_movemask_epi8(hits))) << i;
+            escapes |= static_cast<uint64_t>(static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(head, e)))) << i;
+        }
+    }
+
+#endif // CPP_STRING_UTILS_SIMD_X86
+};
+
+// Yields positions of unescaped, non-overlapping occurrences of a delimiter sequence
+// from `pos` onwards. Only candidates whose first and last bytes match are compared
+// in full. Escape chars inside a matched sequence do not escape the byte after it,
+// and a sequence starting with the escape char turns escaping off.
+class sequence_scanner {
+public:
+    sequence_scanner() noexcept {}
+    sequence_scanner(const std::string_view str, const size_t pos,
+            const delimiter_sequence& sequence, const char escape) noexcept
+        : m_str(str), m_sequence(sequence.view()), m_block(pos), m_resume(pos),
+          m_escape(escape), m_avx2(has_avx2()) {
+        if (m_sequence.empty()) {
+            m_block = m_str.size();
+            return;
+        }
+        m_isEscaping = m_sequence.front() != escape;
+        m_restart = m_isEscaping && m_sequence.find(escape) != std::string_view::npos;
+        if (m_block < m_str.size()) {
+            load();
+        }
+    }
+
+    size_t delimiter_size() const noexcept {
+        return m_sequence.size();
+    }
+
+    // Returns the position of the next delimiter or `npos`.
+    size_t next() noexcept {
+        while (true) {
+            while (m_candidates == 0) {
+                m_block += 64;
+                if (m_block >= m_str.size()) {
+                    m_block = m_str.size();
+                    return std::string_view::npos;
+                }
+                load();
+            }
+            const size_t pos = m_block + ctz64(m_candidates);
+            m_candidates &= m_candidates - 1;
+            if (pos < m_resume) {
+                continue;
+            }
+            if (m_sequence.size() > 2 && std::memcmp(m_str.data() + pos + 1,
+                    m_sequence.data() + 1, m_sequence.size() - 2) != 0) {
                 continue;
             }
+            m_resume = pos + m_sequence.size();
+            if (m_restart) {
+                m_block = m_resume;
+                m_carry = 0;
+                m_candidates = 0;
+                if (m_block < m_str.size()) {
+                    load();
+                }
+            }
+            return pos;
+        }
+    }
+
+private:
+    void load() noexcept {
+        const size_t size = m_str.size() - m_block;
+        const char* p = m_str.data() + m_block;
+        const size_t lastOffset = m_sequence.size() - 1;
+        uint64_t candidates = 0;
+        uint64_t escapes = 0;
+        if (size < 64 + lastOffset) {
+            match64::scalar(p, size, m_sequence.front(), m_sequence.back(),
+                lastOffset, m_escape, candidates, escapes);
         }
         else {
-            isPrevEscape = false;
-            continue;
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+            if (m_avx2) {
+                match64::avx2(p, m_sequence.front(), m_sequence.back(),
+                    lastOffset, m_escape, candidates, escapes);
+            }
+            else {
+                match64::sse2(p, m_sequence.front(), m_sequence.back(),
+                    lastOffset, m_escape, candidates, escapes);
+            }
+#else
+            match64::scalar(p, size, m_sequence.front(), m_sequence.back(),
+                lastOffset, m_escape, candidates, escapes);
+#endif
         }
-        if (by.find(str[i]) == std::string_view::npos) {
-            continue;
+        if (!m_isEscaping) {
+            m_candidates = candidates;
+            return;
         }
+        const uint64_t escaped = escaped_mask(escapes, m_carry);
+        m_candidates = candidates & ~escaped;
+    }
+
+    std::string_view m_str;
+    std::string_view m_sequence;
+    size_t m_block = 0;
+    size_t m_resume = 0;
+    uint64_t m_candidates = 0;
+    uint64_t m_carry = 0;
+    char m_escape = 0;
+    bool m_avx2 = false;
+    bool m_restart = false;
+    bool m_isEscaping = true;
+};
+
+template<typename delimiter_t>
+struct scanner_of;
+template<>
+struct scanner_of<delimiter_set> {
+    using type = delimiter_scanner;
+};
+template<>
+struct scanner_of<delimiter_sequence> {
+    using type = sequence_scanner;
+};
+
+template<typename callable_t, typename... args_t>
+struct is_invocable {
+    template<typename f_t>
+    static auto test(int) -> decltype(
+        std::declval<f_t>()(std::declval<args_t>()...), std::true_type());
+    template<typename>
+    static std::false_type test(...);
+    static constexpr bool value = decltype(test<callable_t>(0))::value;
+};
+
+// Lets the templated overloads keep the early return for empty handlers.
+template<typename callable_t>
+inline bool is_null(const callable_t&) noexcept {
+    return false;
+}
+template<typename callable_t>
+inline bool is_null(callable_t* const callable) noexcept {
+    return callable == nullptr;
+}
+template<typename signature_t>
+inline bool is_null(const std::function<signature_t>& callable) noexcept {
+    return !callable;
+}
+
+struct noop {
+    template<typename... args_t>
+    void operator()(args_t&&...) const noexcept {}
+};
+
+template<typename delimiter_t, typename handler_t>
+inline void split(const std::string_view str, const delimiter_t& by,
+        handler_t&& handler, const bool withEmpty, const char escape) {
+    typename scanner_of<delimiter_t>::type scanner(str, 0, by, escape);
+    size_t begin = 0;
+    uint32_t idx = 0;
+    for (size_t i = scanner.next(); i != std::string_view::npos; i = scanner.next()) {
         const std::string_view part = str.substr(begin, i - begin);
         if (withEmpty || !part.empty()) {
             handler(part, idx++);
         }
-        begin = i + 1;
+        begin = i + scanner.delimiter_size();
     }
     const std::string_view part = str.substr(begin);
     if (!part.empty()) {
@@ -155,120 +943,2196 @@ inline void split(const checked_string_view str, const checked_string_view by,
     }
 }
 
-inline std::string_view substr(const checked_string_view str, size_t& offset,
-        const checked_string_view split_by,
-        const bool withEmpty = false, const char escape = '\\') noexcept {
-    if (split_by.empty()) {
-        return {};
-    }
+template<typename delimiter_t>
+inline std::string_view substr(const std::string_view str, size_t& offset,
+        const delimiter_t& split_by, const bool withEmpty, const char escape) noexcept {
     if (offset >= str.size()) {
         return {};
     }
+    typename scanner_of<delimiter_t>::type scanner(str, offset, split_by, escape);
     size_t begin = offset;
-    bool isPrevEscape = false;
-    for (; offset < str.size(); ++offset) {
-        if (!isPrevEscape) {
-            if (str[offset] == escape) {
-                isPrevEscape = true;
-                continue;
-            }
-        }
-        else {
-            isPrevEscape = false;
-            continue;
-        }
-        if (split_by.find(str[offset]) == std::string_view::npos) {
-            continue;
-        }
-        const std::string_view part = str.substr(begin, offset - begin);
+    for (size_t i = scanner.next(); i != std::string_view::npos; i = scanner.next()) {
+        const std::string_view part = str.substr(begin, i - begin);
         if (withEmpty || !part.empty()) {
-            ++offset;
+            offset = i + scanner.delimiter_size();
             return part;
         }
-        begin = offset + 1;
+        begin = i + scanner.delimiter_size();
     }
     const std::string_view part = str.substr(begin);
-    ++offset;
+    offset = str.size() + 1;
     if (!part.empty()) {
         return part;
     }
     return {};
 }
 
-inline void parseCSV(const checked_string_view csv,
-        const std::function<void(std::string_view cell, uint32_t idx)> onCell,
-        const std::function<void()> onEndl = nullptr) {
-    if (!onCell) {
-        return;
+// Removes the escape chars from `part`, keeping the bytes they escape.
+inline std::string_view unescape(const std::string_view part, char* const out,
+        const char escape) noexcept {
+    size_t size = 0;
+    for (size_t i = 0; i < part.size(); ++i) {
+        if (part[i] == escape && i + 1 < part.size()) {
+            ++i;
+        }
+        out[size++] = part[i];
     }
-    std::string cell;
-    bool isString = false;
-    bool isPrevQuotes = false;
-    bool isPrevEndl = false;
+    return std::string_view(out, size);
+}
+
+template<typename handler_t>
+inline bool split_unescaped(const std::string_view str, const delimiter_set& by,
+        bump_arena& arena, handler_t&& handler, const bool withEmpty, const char escape) {
+    delimiter_scanner scanner(str, 0, by, escape);
+    const auto emit = [&](const std::string_view part, const size_t begin,
+            const size_t end, const uint32_t idx) -> bool {
+        if (!scanner.has_escape(begin, end)) {
+            handler(part, idx);
+            return true;
+        }
+        char* out = arena.allocate(part.size());
+        if (out == nullptr) {
+            return false;
+        }
+        const std::string_view unescaped = unescape(part, out, escape);
+        arena.shrink_last(part.size(), unescaped.size());
+        handler(unescaped, idx);
+        return true;
+    };
+    size_t begin = 0;
     uint32_t idx = 0;
-    for (const char c : csv) {
-        if (isString) {
-            switch (c) {
-            case '"':
-                isString = false;
-                isPrevQuotes = true;
-                break;
-            case ',':
-            case '\n':
-            case '\r':
-            default:
-                cell.push_back(c);
-                break;
+    for (size_t i = scanner.next(); i != std::string_view::npos; i = scanner.next()) {
+        const std::string_view part = str.substr(begin, i - begin);
+        if (withEmpty || !part.empty()) {
+            if (!emit(part, begin, i, idx++)) {
+                return false;
             }
         }
-        else {
-            switch (c) {
-            case '"':
-                if (isPrevQuotes) {
-                    isPrevQuotes = false;
-                    cell.push_back('"');
-                }
-                isString = true;
-                break;
-            case ',':
-                onCell(cell, idx);
-                cell.clear();
-                ++idx;
-                break;
-            case 0:
-            case '\n':
-            case '\r':
-                if (!cell.empty()) {
-                    onCell(cell, idx);
-                    cell.clear();
-                }
-                if (!isPrevEndl && onEndl) {
-                    isPrevEndl = true;
-                    onEndl();
-                }
-                idx = 0;
-                break;
-            default:
-                cell.push_back(c);
+        begin = i + 1;
+    }
+    const std::string_view part = str.substr(begin);
+    if (!part.empty()) {
+        return emit(part, begin, str.size(), idx);
+    }
+    return true;
+}
+
+// Runs `task(i)` for each `i` in [0, count), each on its own thread. Task 0 runs on
+// the calling thread, as do tasks whose thread fails to start. Threads are started
+// per call: each task covers at least a MB of input, which outweighs the start-up.
+// Once all tasks are done, the first exception thrown by a task, in task order, is
+// rethrown on the calling thread.
+template<typename task_t>
+inline void parallel_for(const uint32_t count, task_t&& task) {
+    std::vector<std::exception_ptr> errors(count);
+    const auto run = [&task, &errors](const uint32_t i) noexcept {
+        try {
+            task(i);
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    uint32_t started = 1;
+    try {
+        workers.reserve(count);
+        for (; started < count; ++started) {
+            workers.emplace_back(run, started);
+        }
+    }
+    catch (...) {
+    }
+    run(0);
+    for (uint32_t i = started; i < count; ++i) {
+        run(i);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+inline uint32_t thread_count(uint32_t threads, const size_t size,
+        const size_t minChunk) noexcept {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    const size_t chunks = size / minChunk;
+    if (chunks < threads) {
+        threads = static_cast<uint32_t>(chunks);
+    }
+    return threads == 0 ? 1 : threads;
+}
+
+// Handles the parts starting after the delimiters in [from, to), the first part
+// too when `from` is 0. Empty ranges own no parts. Resolves the escape state at
+// `from` from the run of escape chars before it. Returns the number of parts passed
+// to `handler`.
+template<typename handler_t>
+inline uint32_t split_chunk(const std::string_view str, const size_t from, const size_t to,
+        const delimiter_set& by, handler_t&& handler, const bool withEmpty,
+        const char escape, uint32_t idx) {
+    if (from >= to) {
+        return 0;
+    }
+    size_t escapes = 0;
+    while (escapes < from && str[from - 1 - escapes] == escape) {
+        ++escapes;
+    }
+    delimiter_scanner scanner(str, from, by, escape, (escapes & 1) != 0);
+    size_t begin = 0;
+    if (from != 0) {
+        const size_t first = scanner.next();
+        if (first == std::string_view::npos || first >= to) {
+            return 0;
+        }
+        begin = first + 1;
+    }
+    const uint32_t first = idx;
+    while (true) {
+        const size_t i = scanner.next();
+        if (i == std::string_view::npos) {
+            const std::string_view part = str.substr(begin);
+            if (!part.empty()) {
+                handler(part, idx++);
+            }
+            break;
+        }
+        const std::string_view part = str.substr(begin, i - begin);
+        if (withEmpty || !part.empty()) {
+            handler(part, idx++);
+        }
+        if (i >= to) {
+            break;
+        }
+        begin = i + 1;
+    }
+    return idx - first;
+}
+
+template<typename handler_t>
+inline void split_parallel(const std::string_view str, const delimiter_set& by,
+        handler_t&& handler, const bool withEmpty, const char escape, uint32_t threads) {
+    threads = thread_count(threads, str.size(), 1 << 20);
+    if (threads == 1) {
+        split(str, by, handler, withEmpty, escape);
+        return;
+    }
+    std::vector<size_t> bounds(threads + 1);
+    for (uint32_t i = 0; i <= threads; ++i) {
+        bounds[i] = static_cast<size_t>(
+            static_cast<unsigned long long>(str.size()) * i / threads);
+    }
+    // The first pass only counts parts, so the second one knows each chunk's first index.
+    std::vector<uint32_t> counts(threads + 1);
+    parallel_for(threads, [&](const uint32_t chunk) {
+        counts[chunk + 1] = split_chunk(str, bounds[chunk], bounds[chunk + 1], by,
+            noop(), withEmpty, escape, 0);
+    });
+    for (uint32_t i = 1; i <= threads; ++i) {
+        counts[i] += counts[i - 1];
+    }
+    parallel_for(threads, [&](const uint32_t chunk) {
+        split_chunk(str, bounds[chunk], bounds[chunk + 1], by,
+            handler, withEmpty, escape, counts[chunk]);
+    });
+}
+
+inline split_result split_into(const std::string_view str, const delimiter_set& by,
+        std::string_view* const parts, const size_t capacity,
+        const bool withEmpty, const char escape) noexcept {
+    if (capacity == 0) {
+        return { 0, str };
+    }
+    delimiter_scanner scanner(str, 0, by, escape);
+    size_t begin = 0;
+    size_t count = 0;
+    for (size_t i = scanner.next(); i != std::string_view::npos; i = scanner.next()) {
+        const std::string_view part = str.substr(begin, i - begin);
+        begin = i + 1;
+        if (withEmpty || !part.empty()) {
+            parts[count++] = part;
+            if (count == capacity) {
+                return { count, str.substr(begin) };
+            }
+        }
+    }
+    const std::string_view part = str.substr(begin);
+    if (!part.empty()) {
+        parts[count++] = part;
+    }
+    return { count, str.substr(str.size()) };
+}
+
+} // namespace detail
+
+// Non-owning reference to a callable. Unlike `std::function` it never allocates,
+// so it must not outlive the referenced callable.
+template<typename signature_t>
+class function_ref;
+
+template<typename return_t, typename... args_t>
+class function_ref<return_t(args_t...)> {
+public:
+    _CONSTEXPR17 function_ref() noexcept {}
+    _CONSTEXPR17 function_ref(std::nullptr_t) noexcept {}
+    template<typename callable_t,
+        typename std::enable_if<
+            !std::is_same<typename std::decay<callable_t>::type, function_ref>::value
+            && !std::is_function<typename std::remove_reference<callable_t>::type>::value
+            && detail::is_invocable<callable_t&, args_t...>::value, bool
+        >::type = true>
+    inline function_ref(callable_t&& callable) noexcept
+        : m_object(const_cast<void*>(static_cast<const void*>(&callable))),
+          m_invoke(&invoke_object<typename std::remove_reference<callable_t>::type>) {
+        if (detail::is_null(callable)) {
+            m_invoke = nullptr;
+        }
+    }
+    inline function_ref(return_t (*function)(args_t...)) noexcept
+        : m_object(reinterpret_cast<void*>(function)),
+          m_invoke(function == nullptr ? nullptr : &invoke_function) {}
+
+    inline return_t operator()(args_t... args) const {
+        return m_invoke(m_object, std::forward<args_t>(args)...);
+    }
+    _CONSTEXPR17 explicit operator bool() const noexcept {
+        return m_invoke != nullptr;
+    }
+
+private:
+    template<typename callable_t>
+    static return_t invoke_object(void* object, args_t... args) {
+        return (*static_cast<callable_t*>(object))(std::forward<args_t>(args)...);
+    }
+    static return_t invoke_function(void* function, args_t... args) {
+        return reinterpret_cast<return_t (*)(args_t...)>(function)(
+            std::forward<args_t>(args)...);
+    }
+
+    void* m_object = nullptr;
+    return_t (*m_invoke)(void*, args_t...) = nullptr;
+};
+
+// Non-owning view of a contiguous sequence, a minimal stand-in for C++20 `std::span`.
+template<typename element_t>
+class span {
+public:
+    using element_type = element_t;
+    using value_type = typename std::remove_cv<element_t>::type;
+    using iterator = element_t*;
+
+    _CONSTEXPR17 span() noexcept {}
+    _CONSTEXPR17 span(element_t* data, const size_t size) noexcept
+        : m_data(data), m_size(size) {}
+    template<size_t size>
+    _CONSTEXPR17 span(element_t (&array)[size]) noexcept
+        : m_data(array), m_size(size) {}
+    // Any contiguous container with `data()` and `size()`: `std::vector`, `std::array`, `span`.
+    template<typename container_t,
+        typename std::enable_if<
+            !std::is_same<typename std::remove_cv<container_t>::type, span>::value
+            && std::is_convertible<
+                decltype(std::declval<container_t&>().data()), element_t*>::value, bool
+        >::type = true>
+    _CONSTEXPR17 span(container_t& container) noexcept
+        : m_data(container.data()), m_size(container.size()) {}
+
+    _CONSTEXPR17 element_t* data() const noexcept {
+        return m_data;
+    }
+    _CONSTEXPR17 size_t size() const noexcept {
+        return m_size;
+    }
+    _CONSTEXPR17 bool empty() const noexcept {
+        return m_size == 0;
+    }
+    _CONSTEXPR17 element_t& operator[](const size_t idx) const noexcept {
+        return m_data[idx];
+    }
+    _CONSTEXPR17 iterator begin() const noexcept {
+        return m_data;
+    }
+    _CONSTEXPR17 iterator end() const noexcept {
+        return m_data + m_size;
+    }
+    _CONSTEXPR17 span subspan(const size_t offset, const size_t count) const noexcept {
+        return span(m_data + offset, count);
+    }
+
+private:
+    element_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+inline std::string_view trimm(const checked_string_view string,
+        const delimiter_set& by) noexcept {
+    size_t begin = 0;
+    size_t end = string.size();
+    if (begin < end && by.contains(string[begin])) {
+        begin = detail::find_first_not_of(string, begin + 1, end, by, detail::has_avx2());
+    }
+    if (end > begin && by.contains(string[end - 1])) {
+        end = detail::find_last_not_of(string, begin, end - 1, by, detail::has_avx2());
+    }
+    return string.substr(begin, end - begin);
+}
+inline std::string_view trimm(const checked_string_view string,
+        const checked_string_view by) noexcept {
+    return trimm(string, delimiter_set(by));
+}
+// Trims "\t\n\r \0".
+inline std::string_view trimm(const checked_string_view string) noexcept {
+    return trimm(string, detail::whitespace());
+}
+
+// Trims every part in place, e.g. all cells of a row.
+inline void trimm_all(const span<std::string_view> parts, const delimiter_set& by) noexcept {
+    for (std::string_view& part : parts) {
+        part = trimm(part, by);
+    }
+}
+inline void trimm_all(const span<std::string_view> parts, const checked_string_view by) noexcept {
+    trimm_all(parts, delimiter_set(by));
+}
+inline void trimm_all(const span<std::string_view> parts) noexcept {
+    trimm_all(parts, detail::whitespace());
+}
+
+// `handler` is called as `handler(std::string_view part, uint32_t idx)`.
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline void split(const checked_string_view str, const delimiter_set& by,
+        handler_t&& handler, const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || detail::is_null(handler)) {
+        return;
+    }
+    detail::split(str, by, handler, withEmpty, escape);
+}
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline void split(const checked_string_view str, const checked_string_view by,
+        handler_t&& handler, const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || detail::is_null(handler)) {
+        return;
+    }
+    detail::split(str, delimiter_set(by), handler, withEmpty, escape);
+}
+inline void split(const checked_string_view str, const delimiter_set& by,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || !handler) {
+        return;
+    }
+    detail::split(str, by, handler, withEmpty, escape);
+}
+inline void split(const checked_string_view str, const checked_string_view by,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || !handler) {
+        return;
+    }
+    detail::split(str, delimiter_set(by), handler, withEmpty, escape);
+}
+
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline void split(const checked_string_view str, const delimiter_sequence& by,
+        handler_t&& handler, const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || detail::is_null(handler)) {
+        return;
+    }
+    detail::split(str, by, handler, withEmpty, escape);
+}
+inline void split(const checked_string_view str, const delimiter_sequence& by,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || !handler) {
+        return;
+    }
+    detail::split(str, by, handler, withEmpty, escape);
+}
+
+// Same as `split`, but parts holding escape chars are passed unescaped: copied
+// into `arena` without the escape chars. Other parts still refer to `str`.
+// Returns false when `arena` runs out of space; the remaining parts are skipped.
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline bool split_unescaped(const checked_string_view str, const delimiter_set& by,
+        bump_arena& arena, handler_t&& handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || detail::is_null(handler)) {
+        return true;
+    }
+    return detail::split_unescaped(str, by, arena, handler, withEmpty, escape);
+}
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline bool split_unescaped(const checked_string_view str, const checked_string_view by,
+        bump_arena& arena, handler_t&& handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || detail::is_null(handler)) {
+        return true;
+    }
+    return detail::split_unescaped(str, delimiter_set(by), arena, handler, withEmpty, escape);
+}
+inline bool split_unescaped(const checked_string_view str, const delimiter_set& by,
+        bump_arena& arena,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || !handler) {
+        return true;
+    }
+    return detail::split_unescaped(str, by, arena, handler, withEmpty, escape);
+}
+inline bool split_unescaped(const checked_string_view str, const checked_string_view by,
+        bump_arena& arena,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty() || !handler) {
+        return true;
+    }
+    return detail::split_unescaped(str, delimiter_set(by), arena, handler, withEmpty, escape);
+}
+
+// Same parts and indices as `split`, found by up to `threads` threads (one per
+// hardware thread when 0, fewer for inputs under a few MB). `handler` is called
+// concurrently from these threads, in order within each chunk of the input. If it
+// throws, the exception is rethrown here once all threads are done.
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline void split_parallel(const checked_string_view str, const delimiter_set& by,
+        handler_t&& handler, const bool withEmpty = false, const char escape = '\\',
+        const uint32_t threads = 0) {
+    if (by.empty() || detail::is_null(handler)) {
+        return;
+    }
+    detail::split_parallel(str, by, handler, withEmpty, escape, threads);
+}
+template<typename handler_t,
+    typename std::enable_if<
+        detail::is_invocable<handler_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline void split_parallel(const checked_string_view str, const checked_string_view by,
+        handler_t&& handler, const bool withEmpty = false, const char escape = '\\',
+        const uint32_t threads = 0) {
+    if (by.empty() || detail::is_null(handler)) {
+        return;
+    }
+    detail::split_parallel(str, delimiter_set(by), handler, withEmpty, escape, threads);
+}
+inline void split_parallel(const checked_string_view str, const delimiter_set& by,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\', const uint32_t threads = 0) {
+    if (by.empty() || !handler) {
+        return;
+    }
+    detail::split_parallel(str, by, handler, withEmpty, escape, threads);
+}
+inline void split_parallel(const checked_string_view str, const checked_string_view by,
+        const function_ref<void(std::string_view part, uint32_t idx)> handler,
+        const bool withEmpty = false, const char escape = '\\', const uint32_t threads = 0) {
+    if (by.empty() || !handler) {
+        return;
+    }
+    detail::split_parallel(str, delimiter_set(by), handler, withEmpty, escape, threads);
+}
+
+inline std::string_view substr(const checked_string_view str, size_t& offset,
+        const delimiter_set& split_by,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (split_by.empty()) {
+        return {};
+    }
+    return detail::substr(str, offset, split_by, withEmpty, escape);
+}
+inline std::string_view substr(const checked_string_view str, size_t& offset,
+        const checked_string_view split_by,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (split_by.empty()) {
+        return {};
+    }
+    return detail::substr(str, offset, delimiter_set(split_by), withEmpty, escape);
+}
+
+inline std::string_view substr(const checked_string_view str, size_t& offset,
+        const delimiter_sequence& split_by,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (split_by.empty()) {
+        return {};
+    }
+    return detail::substr(str, offset, split_by, withEmpty, escape);
+}
+
+// Writes at most `parts.size()` parts into `parts` and stops there, without
+// allocating. The parts are the same as the first ones `split` would produce.
+inline split_result split_into(const checked_string_view str, const delimiter_set& by,
+        const span<std::string_view> parts,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty()) {
+        return { 0, str };
+    }
+    return detail::split_into(str, by, parts.data(), parts.size(), withEmpty, escape);
+}
+inline split_result split_into(const checked_string_view str, const checked_string_view by,
+        const span<std::string_view> parts,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    if (by.empty()) {
+        return { 0, str };
+    }
+    return detail::split_into(str, delimiter_set(by), parts.data(), parts.size(),
+        withEmpty, escape);
+}
+template<size_t size>
+inline split_result split_into(const checked_string_view str, const delimiter_set& by,
+        std::array<std::string_view, size>& parts,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    return split_into(str, by, span<std::string_view>(parts), withEmpty, escape);
+}
+template<size_t size>
+inline split_result split_into(const checked_string_view str, const checked_string_view by,
+        std::array<std::string_view, size>& parts,
+        const bool withEmpty = false, const char escape = '\\') noexcept {
+    return split_into(str, by, span<std::string_view>(parts), withEmpty, escape);
+}
+
+// Lazy range over the parts `split` would produce, found one at a time.
+// Iterators refer to the view, so it must outlive them.
+class split_view {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() noexcept {}
+
+        reference operator*() const noexcept {
+            return m_part;
+        }
+        pointer operator->() const noexcept {
+            return &m_part;
+        }
+        // Same as the `idx` passed to a `split` handler.
+        uint32_t index() const noexcept {
+            return m_idx;
+        }
+
+        iterator& operator++() noexcept {
+            ++m_idx;
+            advance();
+            return *this;
+        }
+        iterator operator++(int) noexcept {
+            iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const iterator& other) const noexcept {
+            if (m_view == nullptr || other.m_view == nullptr) {
+                return m_view == other.m_view;
+            }
+            return m_part.data() == other.m_part.data()
+                && m_part.size() == other.m_part.size();
+        }
+        bool operator!=(const iterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+    private:
+        friend class split_view;
+
+        explicit iterator(const split_view& view) noexcept
+                : m_view(&view),
+                  m_scanner(view.m_str, 0, view.m_by, view.m_escape) {
+            if (view.m_by.empty()) {
+                m_view = nullptr;
+                return;
+            }
+            advance();
+        }
+
+        void advance() noexcept {
+            const std::string_view str = m_view->m_str;
+            for (size_t i = m_scanner.next(); i != std::string_view::npos; i = m_scanner.next()) {
+                const std::string_view part = str.substr(m_begin, i - m_begin);
+                m_begin = i + 1;
+                if (m_view->m_withEmpty || !part.empty()) {
+                    m_part = part;
+                    return;
+                }
+            }
+            if (m_begin < str.size()) {
+                m_part = str.substr(m_begin);
+                m_begin = str.size();
+                return;
+            }
+            m_view = nullptr; // end
+        }
+
+        const split_view* m_view = nullptr;
+        detail::delimiter_scanner m_scanner;
+        size_t m_begin = 0;
+        std::string_view m_part;
+        uint32_t m_idx = 0;
+    };
+    using const_iterator = iterator;
+
+    split_view(const checked_string_view str, const delimiter_set& by,
+            const bool withEmpty = false, const char escape = '\\') noexcept
+        : m_str(str), m_by(by), m_withEmpty(withEmpty), m_escape(escape) {}
+    split_view(const checked_string_view str, const checked_string_view by,
+            const bool withEmpty = false, const char escape = '\\') noexcept
+        : m_str(str), m_by(by), m_withEmpty(withEmpty), m_escape(escape) {}
+
+    iterator begin() const noexcept {
+        return iterator(*this);
+    }
+    iterator end() const noexcept {
+        return iterator();
+    }
+
+private:
+    std::string_view m_str;
+    delimiter_set m_by;
+    bool m_withEmpty = false;
+    char m_escape = '\\';
+};
+
+// Cursor over the parts `substr` would return for successive offsets. It keeps the
+// scanner state between calls, so each `next` costs amortized O(1) per part.
+class tokenizer {
+public:
+    tokenizer(const checked_string_view str, const delimiter_set& by,
+            const bool withEmpty = false, const char escape = '\\') noexcept
+        : m_str(str), m_by(by), m_scanner(m_str, 0, m_by, escape), m_withEmpty(withEmpty) {
+        advance();
+    }
+    tokenizer(const checked_string_view str, const checked_string_view by,
+            const bool withEmpty = false, const char escape = '\\') noexcept
+        : m_str(str), m_by(by), m_scanner(m_str, 0, m_by, escape), m_withEmpty(withEmpty) {
+        advance();
+    }
+    tokenizer(const tokenizer& other) noexcept {
+        *this = other;
+    }
+    tokenizer& operator=(const tokenizer& other) noexcept {
+        m_str = other.m_str;
+        m_by = other.m_by;
+        m_scanner = other.m_scanner;
+        m_scanner.rebind(m_by);
+        m_part = other.m_part;
+        m_begin = other.m_begin;
+        m_partEnd = other.m_partEnd;
+        m_offset = other.m_offset;
+        m_withEmpty = other.m_withEmpty;
+        m_done = other.m_done;
+        return *this;
+    }
+
+    // Returns the next part or an empty view without data when none are left.
+    std::string_view next() noexcept {
+        if (m_done) {
+            return {};
+        }
+        const std::string_view part = m_part;
+        m_offset = m_partEnd;
+        advance();
+        return part;
+    }
+    // Returns the part the next call to `next` will return.
+    std::string_view peek() const noexcept {
+        return m_part;
+    }
+    // The input after the last part returned, starting at `offset`.
+    std::string_view rest() const noexcept {
+        return m_str.substr(m_offset < m_str.size() ? m_offset : m_str.size());
+    }
+    // Same as the `offset` a `substr` call would leave.
+    size_t offset() const noexcept {
+        return m_offset;
+    }
+    bool done() const noexcept {
+        return m_done;
+    }
+
+private:
+    void advance() noexcept {
+        if (m_by.empty()) {
+            m_done = true;
+            return;
+        }
+        for (size_t i = m_scanner.next(); i != std::string_view::npos; i = m_scanner.next()) {
+            const std::string_view part = m_str.substr(m_begin, i - m_begin);
+            m_begin = i + 1;
+            if (m_withEmpty || !part.empty()) {
+                m_part = part;
+                m_partEnd = m_begin;
+                return;
+            }
+        }
+        if (m_begin < m_str.size()) {
+            m_part = m_str.substr(m_begin);
+            m_begin = m_str.size();
+            m_partEnd = m_str.size() + 1;
+            return;
+        }
+        m_part = {};
+        m_done = true;
+    }
+
+    std::string_view m_str;
+    delimiter_set m_by;
+    detail::delimiter_scanner m_scanner;
+    std::string_view m_part;
+    size_t m_begin = 0;
+    size_t m_partEnd = 0;
+    size_t m_offset = 0;
+    bool m_withEmpty = false;
+    bool m_done = false;
+};
+
+// How `parseCSV` ends rows.
+enum class csv_endl : uint8_t {
+    any, // `\n`, `\r` and `\0` each end a row, blank lines are skipped
+    lf,  // `\n` ends a row and drops a `\r` before it, blank lines are empty rows
+};
+
+// CSV dialect for `parseCSV`, fixed at compile time, e.g. `csv_dialect<'\t'>` for TSV.
+// Rows starting with `comment` are skipped, unless it is 0. `header` skips the first
+// row with cells and any blank lines before it.
+template<char delimiter_v = ',', char quote_v = '"', char comment_v = 0,
+    csv_endl endl_v = csv_endl::any, bool header_v = false>
+struct csv_dialect {
+    static constexpr char delimiter = delimiter_v;
+    static constexpr char quote = quote_v;
+    static constexpr char comment = comment_v;
+    static constexpr csv_endl endl = endl_v;
+    static constexpr bool header = header_v;
+};
+
+namespace detail {
+
+// CSV cell under construction: a view of the input while its bytes are contiguous
+// there, copied into a reusable scratch buffer only once quotes break it up.
+class csv_cell {
+public:
+    csv_cell(const std::string_view csv, std::string& scratch) noexcept
+        : m_csv(csv), m_scratch(scratch) {}
+
+    // Appends the bytes in [begin, end).
+    void push(const size_t begin, const size_t end) {
+        if (m_isCopied) {
+            m_scratch.append(m_csv.data() + begin, end - begin);
+        }
+        else if (m_begin == m_end) {
+            m_begin = begin;
+            m_end = end;
+        }
+        else if (m_end == begin) {
+            m_end = end;
+        }
+        else {
+            m_scratch.assign(m_csv.data() + m_begin, m_end - m_begin);
+            m_scratch.append(m_csv.data() + begin, end - begin);
+            m_isCopied = true;
+        }
+    }
+    std::string_view view() const noexcept {
+        if (m_isCopied) {
+            return std::string_view(m_scratch.data(), m_scratch.size());
+        }
+        return m_csv.substr(m_begin, m_end - m_begin);
+    }
+    bool empty() const noexcept {
+        return m_isCopied ? m_scratch.empty() : m_begin == m_end;
+    }
+    void clear() noexcept {
+        m_begin = m_end;
+        m_isCopied = false;
+    }
+
+private:
+    const std::string_view m_csv;
+    std::string& m_scratch;
+    size_t m_begin = 0;
+    size_t m_end = 0;
+    bool m_isCopied = false;
+};
+
+// Bits set from each quote up to (not including) the next one: bit N is the XOR
+// of bits [0, N] of `quotes`.
+inline uint64_t prefix_xor_scalar(uint64_t bits) noexcept {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+// Carry-less multiplication by all-ones computes the same prefix XOR at once.
+CPP_STRING_UTILS_TARGET("pclmul")
+inline uint64_t prefix_xor_pclmul(const uint64_t bits) noexcept {
+    const __m128i product = _mm_clmulepi64_si128(
+        _mm_set_epi64x(0, static_cast<int64_t>(bits)), _mm_set1_epi8(-1), 0);
+    uint64_t result = 0;
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&result), product);
+    return result;
+}
+#endif // CPP_STRING_UTILS_SIMD_X86
+
+// Marks the bytes inside quotes, given `quotes` of a block and `inQuotes`, all ones
+// when the block starts inside quotes. `inQuotes` receives the same for the next block.
+inline uint64_t quoted_mask(const uint64_t quotes, uint64_t& inQuotes,
+        const bool pclmul) noexcept {
+    uint64_t inside = 0;
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    inside = pclmul ? prefix_xor_pclmul(quotes) : prefix_xor_scalar(quotes);
+#else
+    (void)pclmul;
+    inside = prefix_xor_scalar(quotes);
+#endif
+    inside ^= inQuotes;
+    inQuotes = 0 - (inside >> 63);
+    return inside;
+}
+
+// Structural characters of a 64-byte CSV block.
+struct csv_block {
+    uint64_t separators; // delimiters and row ends outside quotes
+    uint64_t quotes;
+};
+
+template<typename dialect_t>
+inline bool is_csv_endl(const char c) noexcept {
+    return dialect_t::endl == csv_endl::lf ? c == '\n' : c == '\n' || c == '\r' || c == '\0';
+}
+
+// Delimiter and row end chars of `dialect_t`.
+template<typename dialect_t>
+inline const delimiter_set& csv_separators() noexcept {
+    static const char chars[] = { dialect_t::delimiter, '\n', '\r', '\0' };
+    static const delimiter_set set(chars, dialect_t::endl == csv_endl::lf ? 2 : 4);
+    return set;
+}
+
+// Stage 1 of `parseCSV`: classifies the input 64 bytes at a time and masks out
+// separators inside quotes, carrying the quote state from block to block.
+template<typename dialect_t = csv_dialect<>>
+class csv_indexer {
+public:
+    explicit csv_indexer(const bool inQuotes = false) noexcept
+        : m_inQuotes(inQuotes ? ~uint64_t(0) : 0),
+        m_avx2(has_avx2()), m_pclmul(has_pclmul()) {}
+
+    // Indexes the first `size` bytes at `p`, at most 64.
+    csv_block index(const char* p, const size_t size) noexcept {
+        csv_block block;
+        classify(p, size, csv_separators<dialect_t>(), dialect_t::quote, m_avx2,
+            block.separators, block.quotes);
+        // Bits past `size` repeat the last state, so the carry stays right.
+        block.separators &= ~quoted_mask(block.quotes, m_inQuotes, m_pclmul);
+        return block;
+    }
+    bool in_quotes() const noexcept {
+        return m_inQuotes != 0;
+    }
+
+private:
+    uint64_t m_inQuotes;
+    bool m_avx2;
+    bool m_pclmul;
+};
+
+// Decodes the cell in [begin, end), which holds quotes: quoted sections lose their
+// quotes and `""` inside them becomes `"`.
+template<char quote_v = '"'>
+inline void decode_csv_cell(const std::string_view csv, size_t begin, const size_t end,
+        csv_cell& cell) {
+    bool isString = false;
+    bool isPrevQuotes = false;
+    while (begin < end) {
+        const void* quote = std::memchr(csv.data() + begin, quote_v, end - begin);
+        const size_t pos = quote == nullptr ? end
+            : static_cast<const char*>(quote) - csv.data();
+        if (pos != begin) {
+            cell.push(begin, pos);
+            isPrevQuotes = false;
+        }
+        if (pos == end) {
+            break;
+        }
+        if (isString) {
+            isString = false;
+            isPrevQuotes = true;
+        }
+        else {
+            if (isPrevQuotes) {
+                isPrevQuotes = false;
+                cell.push(pos, pos + 1);
+            }
+            isString = true;
+        }
+        begin = pos + 1;
+    }
+}
+
+// Row state of `parseCSV` between cells.
+struct csv_state {
+    uint32_t idx = 0;
+    bool isPrevEndl = false;
+};
+
+// Passes the cell in [begin, end) of `csv`, which ends at a delimiter or, when
+// `isEndl`, at a row end or the end of input. Only cells that `isQuoted` are decoded.
+template<typename dialect_t = csv_dialect<>, typename on_cell_t, typename on_endl_t>
+inline void end_csv_cell(const std::string_view csv, const size_t begin, size_t end,
+        const bool isQuoted, const bool isEndl, csv_state& state, std::string& scratch,
+        on_cell_t& onCell, on_endl_t& onEndl) {
+    if (!isEndl) {
+        if (isQuoted) {
+            csv_cell cell(csv, scratch);
+            decode_csv_cell<dialect_t::quote>(csv, begin, end, cell);
+            onCell(cell.view(), state.idx);
+        }
+        else {
+            onCell(csv.substr(begin, end - begin), state.idx);
+        }
+        ++state.idx;
+        state.isPrevEndl = false;
+        return;
+    }
+    if (dialect_t::endl == csv_endl::lf && end != begin && end != csv.size()
+            && csv[end - 1] == '\r') {
+        --end;
+    }
+    if (begin != end) {
+        if (isQuoted) {
+            csv_cell cell(csv, scratch);
+            decode_csv_cell<dialect_t::quote>(csv, begin, end, cell);
+            if (!cell.empty()) {
+                onCell(cell.view(), state.idx);
+            }
+        }
+        else {
+            onCell(csv.substr(begin, end - begin), state.idx);
+        }
+        onEndl();
+    }
+    else if (dialect_t::endl == csv_endl::lf || !state.isPrevEndl) {
+        onEndl();
+    }
+    state.idx = 0;
+    state.isPrevEndl = true;
+}
+
+// Skips the comment rows at `pos`, a row start, with their row ends.
+template<typename dialect_t>
+inline size_t skip_csv_comments(const std::string_view csv, size_t pos,
+        csv_state& state) noexcept {
+    while (pos < csv.size() && csv[pos] == dialect_t::comment) {
+        while (pos < csv.size() && !is_csv_endl<dialect_t>(csv[pos])) {
+            ++pos;
+        }
+        if (pos < csv.size()) {
+            ++pos;
+        }
+        state.isPrevEndl = true;
+    }
+    return pos;
+}
+
+// Stage 2 of `parseCSV`: walks the separators found by `csv_indexer` from `begin`,
+// the start of a cell (of a row with comments), to the first row end at `stop` or
+// past it, returning `npos`, or to the end of `csv`, returning the start of the
+// unfinished last cell. Cells without quotes are passed as views of `csv` without
+// looking at their bytes again.
+template<typename dialect_t = csv_dialect<>, typename on_cell_t, typename on_endl_t>
+inline size_t parse_csv_rows(const std::string_view csv, const size_t begin,
+        const size_t stop, csv_state& state, std::string& scratch,
+        on_cell_t& onCell, on_endl_t& onEndl) {
+    csv_indexer<dialect_t> indexer;
+    size_t cellBegin = begin;
+    if (dialect_t::comment != 0) {
+        cellBegin = skip_csv_comments<dialect_t>(csv, cellBegin, state);
+    }
+    bool isQuoted = false;
+    size_t base = cellBegin;
+    while (base < csv.size()) {
+        const csv_block block = indexer.index(csv.data() + base, csv.size() - base);
+        uint64_t separators = block.separators;
+        uint64_t quotes = block.quotes;
+        bool isRestarted = false;
+        while (separators != 0) {
+            const uint64_t bit = separators & (~separators + 1);
+            const size_t pos = base + ctz64(separators);
+            separators ^= bit;
+            isQuoted |= (quotes & (bit - 1)) != 0;
+            quotes &= ~(bit - 1);
+            const bool isEndl = csv[pos] != dialect_t::delimiter;
+            if (!isEndl && !isQuoted) { // the common case, inlined
+                onCell(csv.substr(cellBegin, pos - cellBegin), state.idx);
+                ++state.idx;
+                state.isPrevEndl = false;
+            }
+            else {
+                end_csv_cell<dialect_t>(csv, cellBegin, pos, isQuoted, isEndl, state,
+                    scratch, onCell, onEndl);
+                if (isEndl && pos >= stop) {
+                    return std::string_view::npos;
+                }
+            }
+            cellBegin = pos + 1;
+            isQuoted = false;
+            // Quotes in comments don't count, so indexing restarts after them.
+            if (dialect_t::comment != 0 && isEndl && cellBegin < csv.size()
+                    && csv[cellBegin] == dialect_t::comment) {
+                cellBegin = skip_csv_comments<dialect_t>(csv, cellBegin, state);
+                indexer = csv_indexer<dialect_t>();
+                isRestarted = true;
                 break;
             }
-            if (c != '"') {
-                isPrevQuotes = false;
+        }
+        if (isRestarted) {
+            base = cellBegin;
+            continue;
+        }
+        isQuoted |= quotes != 0;
+        base += 64;
+    }
+    return cellBegin;
+}
+
+template<typename dialect_t, typename on_cell_t, typename on_endl_t>
+inline void parse_csv(const std::string_view csv, on_cell_t&& onCell, on_endl_t&& onEndl) {
+    csv_state state;
+    std::string scratch;
+    const size_t tail = parse_csv_rows<dialect_t>(csv, 0, std::string_view::npos, state,
+        scratch, onCell, onEndl);
+    // With `csv_endl::lf` a final row end doesn't start another row.
+    if (dialect_t::endl == csv_endl::lf && tail == csv.size() && state.idx == 0) {
+        return;
+    }
+    end_csv_cell<dialect_t>(csv, tail, csv.size(), true, true, state, scratch,
+        onCell, onEndl);
+}
+
+template<typename dialect_t = csv_dialect<>, typename on_cell_t, typename on_endl_t>
+inline void parseCSV(const std::string_view csv, on_cell_t&& onCell, on_endl_t&& onEndl) {
+    if (!dialect_t::header) {
+        parse_csv<dialect_t>(csv, onCell, onEndl);
+        return;
+    }
+    // The header is the first row with cells; blank lines before it are dropped.
+    bool isHeader = true;
+    bool hasCells = false;
+    parse_csv<dialect_t>(csv,
+        [&](const std::string_view cell, const uint32_t idx) {
+            if (!isHeader) {
+                onCell(cell, idx);
+            }
+            hasCells = true;
+        },
+        [&]() {
+            if (!isHeader) {
+                onEndl();
+            }
+            else if (hasCells) {
+                isHeader = false;
+            }
+        });
+}
+
+// Whether `part` lies within `str`; empty views always do.
+inline bool is_view_of(const std::string_view part, const std::string_view str) noexcept {
+    const std::less<const char*> less;
+    return part.empty() || (!less(part.data(), str.data())
+        && less(part.data(), str.data() + str.size()));
+}
+
+// Gathers the cells of a row for `parseCSV_rows`. Decoded cells only live in the
+// parser's scratch buffer until the next one, so they are copied into a row buffer
+// whose views are fixed up once the row is complete. Both buffers are reused.
+class csv_row {
+public:
+    explicit csv_row(const std::string_view csv) noexcept : m_csv(csv) {}
+
+    void push(const std::string_view cell) {
+        if (!is_view_of(cell, m_csv)) {
+            m_copies.push_back(std::make_pair(m_cells.size(), m_buffer.size()));
+            m_buffer.append(cell.data(), cell.size());
+        }
+        m_cells.push_back(cell);
+    }
+    span<const std::string_view> cells() noexcept {
+        for (const std::pair<size_t, size_t>& copy : m_copies) {
+            m_cells[copy.first] = std::string_view(
+                m_buffer.data() + copy.second, m_cells[copy.first].size());
+        }
+        return span<const std::string_view>(m_cells.data(), m_cells.size());
+    }
+    void clear() noexcept {
+        m_cells.clear();
+        m_copies.clear();
+        m_buffer.clear();
+    }
+
+private:
+    const std::string_view m_csv;
+    std::vector<std::string_view> m_cells;
+    std::vector<std::pair<size_t, size_t>> m_copies; // cell index, offset in `m_buffer`
+    std::string m_buffer;
+};
+
+template<typename dialect_t = csv_dialect<>, typename on_row_t>
+inline void parseCSV_rows(const std::string_view csv, on_row_t&& onRow) {
+    csv_row cells(csv);
+    uint64_t row = 0;
+    parseCSV<dialect_t>(csv,
+        [&](const std::string_view cell, uint32_t) { cells.push(cell); },
+        [&]() {
+            onRow(cells.cells(), row++);
+            cells.clear();
+        });
+}
+
+// What the first pass of `parseCSV_parallel` learns about a chunk, for both quote
+// states at its start. Like that pass, it assumes the default dialect.
+struct csv_chunk {
+    uint64_t rows[2]; // row ends in the chunk when it starts outside / inside quotes
+    bool isQuoteOdd;  // whether the quote state at its end differs from its start
+};
+
+inline csv_chunk count_csv_rows(const std::string_view csv, const size_t from,
+        const size_t to) noexcept {
+    static const delimiter_set endls("\n\r\0");
+    const bool avx2 = has_avx2();
+    const bool pclmul = has_pclmul();
+    csv_chunk chunk = {{ 0, 0 }, false };
+    uint64_t inQuotes = 0;
+    uint64_t prevEndl = from != 0 && is_csv_endl<csv_dialect<>>(csv[from - 1]);
+    for (size_t base = from; base < to; base += 64) {
+        uint64_t ends = 0;
+        uint64_t quotes = 0;
+        classify(csv.data() + base, to - base < 64 ? to - base : 64, endls, '"', avx2,
+            ends, quotes);
+        const uint64_t inside = quoted_mask(quotes, inQuotes, pclmul);
+        // Only the first of consecutive row ends ends a row; quotes never sit
+        // between them, so this holds in both states.
+        const uint64_t firsts = ends & ~((ends << 1) | prevEndl);
+        prevEndl = ends >> 63;
+        chunk.rows[0] += popcount64(firsts & ~inside);
+        chunk.rows[1] += popcount64(firsts & inside);
+    }
+    chunk.isQuoteOdd = inQuotes != 0;
+    return chunk;
+}
+
+// Position of the first separator (only row ends when `isEndl`) at `from` or past
+// it, or `npos`. `indexer` holds the quote state at `from`.
+template<typename dialect_t>
+inline size_t find_csv_separator(const std::string_view csv, const size_t from,
+        csv_indexer<dialect_t>& indexer, const bool isEndl) noexcept {
+    for (size_t base = from; base < csv.size(); base += 64) {
+        uint64_t separators = indexer.index(csv.data() + base, csv.size() - base).separators;
+        for (; separators != 0; separators &= separators - 1) {
+            const size_t pos = base + ctz64(separators);
+            if (!isEndl || csv[pos] != dialect_t::delimiter) {
+                return pos;
+            }
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Appends the row starts in [from, to) to `starts`: the bytes after a row end
+// outside quotes that aren't row ends themselves, so blank lines are skipped like
+// `parseCSV` does. `inQuotes` is the quote state at `from`.
+inline void find_csv_rows(const std::string_view csv, const size_t from, const size_t to,
+        const bool inQuotes, std::vector<uint64_t>& starts) {
+    static const delimiter_set endls("\n\r\0");
+    const bool avx2 = has_avx2();
+    const bool pclmul = has_pclmul();
+    uint64_t quoteState = inQuotes ? ~uint64_t(0) : 0;
+    // A row end is never a quote, so the state at `from - 1` is that at `from`.
+    uint64_t prevEndl = from != 0 && !inQuotes && is_csv_endl<csv_dialect<>>(csv[from - 1]);
+    for (size_t base = from; base < to; base += 64) {
+        const size_t size = to - base < 64 ? to - base : 64;
+        uint64_t ends = 0;
+        uint64_t quotes = 0;
+        classify(csv.data() + base, size, endls, '"', avx2, ends, quotes);
+        const uint64_t outside = ends & ~quoted_mask(quotes, quoteState, pclmul);
+        uint64_t rows = ~ends & ((outside << 1) | prevEndl);
+        prevEndl = outside >> 63;
+        if (size < 64) {
+            rows &= (uint64_t(1) << size) - 1;
+        }
+        for (; rows != 0; rows &= rows - 1) {
+            starts.push_back(base + ctz64(rows));
+        }
+    }
+}
+
+// Each chunk owns the rows starting after the row ends in it, the first chunk the
+// first row too. The first pass counts row ends in each chunk for both quote states
+// at its start. Chaining the quote parities picks the real state and row index at
+// every chunk start, and the second pass parses each chunk's rows from there.
+template<typename on_cell_t, typename on_endl_t>
+inline void parseCSV_parallel(const std::string_view csv, on_cell_t&& onCell,
+        on_endl_t&& onEndl, uint32_t threads) {
+    threads = thread_count(threads, csv.size(), 1 << 20);
+    if (threads == 1) {
+        uint64_t row = 0;
+        parseCSV(csv,
+            [&](const std::string_view cell, const uint32_t idx) { onCell(cell, idx, row); },
+            [&]() { onEndl(row++); });
+        return;
+    }
+    std::vector<size_t> bounds(threads + 1);
+    for (uint32_t i = 0; i <= threads; ++i) {
+        bounds[i] = static_cast<size_t>(
+            static_cast<unsigned long long>(csv.size()) * i / threads);
+    }
+    std::vector<csv_chunk> chunks(threads);
+    parallel_for(threads, [&](const uint32_t chunk) {
+        chunks[chunk] = count_csv_rows(csv, bounds[chunk], bounds[chunk + 1]);
+    });
+    std::vector<uint64_t> rows(threads);
+    std::vector<char> inQuotes(threads);
+    for (uint32_t i = 1; i < threads; ++i) {
+        const bool prev = inQuotes[i - 1] != 0;
+        rows[i] = rows[i - 1] + chunks[i - 1].rows[prev ? 1 : 0];
+        inQuotes[i] = prev != chunks[i - 1].isQuoteOdd;
+    }
+    parallel_for(threads, [&](const uint32_t chunk) {
+        size_t begin = 0;
+        csv_state state;
+        uint64_t row = rows[chunk];
+        if (chunk != 0) {
+            csv_indexer<> indexer(inQuotes[chunk] != 0);
+            const size_t endl = find_csv_separator(csv, bounds[chunk], indexer, true);
+            if (endl >= bounds[chunk + 1]) {
+                return;
+            }
+            // The previous chunk handles this row end, and has counted it unless
+            // it follows another one.
+            if (!is_csv_endl<csv_dialect<>>(csv[endl - 1])) {
+                ++row;
+            }
+            begin = endl + 1;
+            state.isPrevEndl = true;
+        }
+        const size_t stop = chunk + 1 == threads ? std::string_view::npos : bounds[chunk + 1];
+        std::string scratch;
+        const auto onChunkCell = [&](const std::string_view cell, const uint32_t idx) {
+            onCell(cell, idx, row);
+        };
+        const auto onChunkEndl = [&]() { onEndl(row++); };
+        const size_t tail = parse_csv_rows(csv, begin, stop, state, scratch,
+            onChunkCell, onChunkEndl);
+        if (tail != std::string_view::npos) {
+            end_csv_cell(csv, tail, csv.size(), true, true, state, scratch,
+                onChunkCell, onChunkEndl);
+        }
+    });
+}
+
+} // namespace detail
+
+// `onCell` is called as `onCell(std::string_view cell, uint32_t idx)`, `onEndl` as `onEndl()`.
+// `dialect_t` is a `csv_dialect`, e.g. `parseCSV<csv_dialect<';'>>(csv, onCell)`.
+template<typename dialect_t = csv_dialect<>, typename on_cell_t, typename on_endl_t,
+    typename std::enable_if<
+        detail::is_invocable<on_cell_t&, std::string_view, uint32_t>::value
+        && detail::is_invocable<on_endl_t&>::value, bool
+    >::type = true>
+inline void parseCSV(const checked_string_view csv, on_cell_t&& onCell, on_endl_t&& onEndl) {
+    if (detail::is_null(onCell)) {
+        return;
+    }
+    if (detail::is_null(onEndl)) {
+        detail::parseCSV<dialect_t>(csv, onCell, detail::noop());
+        return;
+    }
+    detail::parseCSV<dialect_t>(csv, onCell, onEndl);
+}
+template<typename dialect_t = csv_dialect<>, typename on_cell_t,
+    typename std::enable_if<
+        detail::is_invocable<on_cell_t&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline void parseCSV(const checked_string_view csv, on_cell_t&& onCell,
+        std::nullptr_t = nullptr) {
+    if (detail::is_null(onCell)) {
+        return;
+    }
+    detail::parseCSV<dialect_t>(csv, onCell, detail::noop());
+}
+inline void parseCSV(const checked_string_view csv,
+        const function_ref<void(std::string_view cell, uint32_t idx)> onCell,
+        const function_ref<void()> onEndl = nullptr) {
+    if (!onCell) {
+        return;
+    }
+    if (!onEndl) {
+        detail::parseCSV(csv, onCell, detail::noop());
+        return;
+    }
+    detail::parseCSV(csv, onCell, onEndl);
+}
+
+// Same as `parseCSV`, but collects each row first: `onRow` is called as
+// `onRow(span<const std::string_view> cells, uint64_t row)` once per row end. The
+// cells are valid only during the call.
+template<typename dialect_t = csv_dialect<>, typename on_row_t,
+    typename std::enable_if<
+        detail::is_invocable<on_row_t&, span<const std::string_view>, uint64_t>::value, bool
+    >::type = true>
+inline void parseCSV_rows(const checked_string_view csv, on_row_t&& onRow) {
+    if (detail::is_null(onRow)) {
+        return;
+    }
+    detail::parseCSV_rows<dialect_t>(csv, onRow);
+}
+inline void parseCSV_rows(const checked_string_view csv,
+        const function_ref<void(span<const std::string_view> cells, uint64_t row)> onRow) {
+    if (!onRow) {
+        return;
+    }
+    detail::parseCSV_rows(csv, onRow);
+}
+
+// Same cells and row ends as `parseCSV`, found by up to `threads` threads (one per
+// hardware thread when 0, fewer for inputs under a few MB). Each call also gets
+// the index of its row among all rows. The handlers are called concurrently from
+// these threads, in order within each chunk of the input. If one throws, the
+// exception is rethrown here once all threads are done. Only the default
+// `csv_dialect<>` is supported: chunks are joined on its quote and row ends.
+template<typename on_cell_t, typename on_endl_t,
+    typename std::enable_if<
+        detail::is_invocable<on_cell_t&, std::string_view, uint32_t, uint64_t>::value
+        && detail::is_invocable<on_endl_t&, uint64_t>::value, bool
+    >::type = true>
+inline void parseCSV_parallel(const checked_string_view csv, on_cell_t&& onCell,
+        on_endl_t&& onEndl, const uint32_t threads = 0) {
+    if (detail::is_null(onCell)) {
+        return;
+    }
+    if (detail::is_null(onEndl)) {
+        detail::parseCSV_parallel(csv, onCell, detail::noop(), threads);
+        return;
+    }
+    detail::parseCSV_parallel(csv, onCell, onEndl, threads);
+}
+template<typename on_cell_t,
+    typename std::enable_if<
+        detail::is_invocable<on_cell_t&, std::string_view, uint32_t, uint64_t>::value, bool
+    >::type = true>
+inline void parseCSV_parallel(const checked_string_view csv, on_cell_t&& onCell,
+        std::nullptr_t = nullptr, const uint32_t threads = 0) {
+    if (detail::is_null(onCell)) {
+        return;
+    }
+    detail::parseCSV_parallel(csv, onCell, detail::noop(), threads);
+}
+inline void parseCSV_parallel(const checked_string_view csv,
+        const function_ref<void(std::string_view cell, uint32_t idx, uint64_t row)> onCell,
+        const function_ref<void(uint64_t row)> onEndl = nullptr, const uint32_t threads = 0) {
+    if (!onCell) {
+        return;
+    }
+    if (!onEndl) {
+        detail::parseCSV_parallel(csv, onCell, detail::noop(), threads);
+        return;
+    }
+    detail::parseCSV_parallel(csv, onCell, onEndl, threads);
+}
+
+// Push-style `parseCSV` for input that arrives in pieces, e.g. from a socket or a
+// decompressor. `feed` passes on the cells and row ends completed by each piece,
+// `finish` those of the end of input, after which the parser starts a new document.
+// Only the unfinished last cell is copied between pieces; other cells are views of
+// the piece being fed. Only the default `csv_dialect<>` is supported, as comment
+// rows and `\r\n` row ends may be cut between pieces.
+template<typename on_cell_t, typename on_endl_t = detail::noop>
+class csv_parser {
+public:
+    explicit csv_parser(on_cell_t onCell, on_endl_t onEndl = on_endl_t())
+        : m_onCell(std::move(onCell)), m_onEndl(std::move(onEndl)) {}
+
+    void feed(const checked_string_view chunk) {
+        detail::csv_indexer<> indexer(m_inQuotes);
+        const size_t first = detail::find_csv_separator(chunk, 0, indexer, false);
+        if (first == std::string_view::npos) {
+            m_pending.append(chunk.data(), chunk.size());
+            m_inQuotes = indexer.in_quotes();
+            return;
+        }
+        std::string_view cell = chunk.substr(0, first);
+        if (!m_pending.empty()) {
+            m_pending.append(cell.data(), cell.size());
+            cell = std::string_view(m_pending.data(), m_pending.size());
+        }
+        detail::end_csv_cell(cell, 0, cell.size(), true, chunk[first] != ',',
+            m_state, m_scratch, m_onCell, m_onEndl);
+        const size_t tail = detail::parse_csv_rows(chunk, first + 1, std::string_view::npos,
+            m_state, m_scratch, m_onCell, m_onEndl);
+        m_pending.assign(chunk.data() + tail, chunk.size() - tail);
+        m_inQuotes = false;
+        for (const char c : m_pending) {
+            m_inQuotes ^= c == '"';
+        }
+    }
+    void finish() {
+        detail::end_csv_cell(std::string_view(m_pending.data(), m_pending.size()),
+            0, m_pending.size(), true, true, m_state, m_scratch, m_onCell, m_onEndl);
+        m_state = detail::csv_state();
+        m_pending.clear();
+        m_inQuotes = false;
+    }
+
+private:
+    on_cell_t m_onCell;
+    on_endl_t m_onEndl;
+    detail::csv_state m_state;
+    std::string m_pending;
+    std::string m_scratch;
+    bool m_inQuotes = false;
+};
+
+// `csv_parser` with the handler types deduced, for C++11. Default dialect only.
+template<typename on_cell_t, typename on_endl_t,
+    typename std::enable_if<
+        detail::is_invocable<typename std::decay<on_cell_t>::type&, std::string_view, uint32_t>::value
+        && detail::is_invocable<typename std::decay<on_endl_t>::type&>::value, bool
+    >::type = true>
+inline csv_parser<typename std::decay<on_cell_t>::type, typename std::decay<on_endl_t>::type>
+make_csv_parser(on_cell_t&& onCell, on_endl_t&& onEndl) {
+    return csv_parser<typename std::decay<on_cell_t>::type, typename std::decay<on_endl_t>::type>(
+        std::forward<on_cell_t>(onCell), std::forward<on_endl_t>(onEndl));
+}
+template<typename on_cell_t,
+    typename std::enable_if<
+        detail::is_invocable<typename std::decay<on_cell_t>::type&, std::string_view, uint32_t>::value, bool
+    >::type = true>
+inline csv_parser<typename std::decay<on_cell_t>::type> make_csv_parser(on_cell_t&& onCell) {
+    return csv_parser<typename std::decay<on_cell_t>::type>(std::forward<on_cell_t>(onCell));
+}
+
+// Contents of a file as one view, e.g. for `parseCSV` and `split`. Regular files are
+// mapped read-only and advised for sequential access, `populate` also faults their
+// pages in ahead of the parser. Pipes and other inputs that can't be mapped (and
+// every file on platforms without `mmap`) are read into a buffer in large blocks.
+class mapped_file {
+public:
+    mapped_file() noexcept = default;
+    explicit mapped_file(const char* path, const bool populate = false) noexcept {
+        open(path, populate);
+    }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept {
+        *this = std::move(other);
+    }
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            close();
+            m_data = other.m_data;
+            m_size = other.m_size;
+            m_buffer = std::move(other.m_buffer);
+            m_isOpen = other.m_isOpen;
+            m_isMapped = other.m_isMapped;
+            other.m_data = nullptr;
+            other.m_size = 0;
+            other.m_buffer.clear();
+            other.m_isOpen = false;
+            other.m_isMapped = false;
+        }
+        return *this;
+    }
+    ~mapped_file() {
+        close();
+    }
+
+    // Returns false when the file can't be opened or read.
+    bool open(const char* path, const bool populate = false) noexcept {
+        close();
+        if (path == nullptr) {
+            return false;
+        }
+#if defined(CPP_STRING_UTILS_MMAP)
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status;
+        bool isRegular = ::fstat(fd, &status) == 0 && S_ISREG(status.st_mode)
+            && static_cast<unsigned long long>(status.st_size) <= SIZE_MAX;
+        m_isOpen = (isRegular && map(fd, static_cast<size_t>(status.st_size), populate))
+            || read(fd, isRegular ? static_cast<size_t>(status.st_size) : 0);
+        ::close(fd);
+#else
+        (void)populate;
+        std::FILE* file = std::fopen(path, "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        m_isOpen = read(file);
+        std::fclose(file);
+#endif
+        if (!m_isOpen) {
+            close();
+        }
+        return m_isOpen;
+    }
+    void close() noexcept {
+#if defined(CPP_STRING_UTILS_MMAP)
+        if (m_isMapped) {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+        m_data = nullptr;
+        m_size = 0;
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+        m_isOpen = false;
+        m_isMapped = false;
+    }
+
+    bool is_open() const noexcept {
+        return m_isOpen;
+    }
+    // Whether the contents are mapped rather than copied into a buffer.
+    bool is_mapped() const noexcept {
+        return m_isMapped;
+    }
+    checked_string_view view() const noexcept {
+        if (m_isMapped) {
+            return checked_string_view(m_data, m_size);
+        }
+        return checked_string_view(m_buffer.data(), m_buffer.size());
+    }
+
+private:
+    static constexpr size_t block_size = 1 << 20;
+
+#if defined(CPP_STRING_UTILS_MMAP)
+    bool map(const int fd, const size_t size, const bool populate) noexcept {
+        if (size == 0) {
+            return true;
+        }
+        int flags = MAP_PRIVATE;
+#   if defined(MAP_POPULATE)
+        if (populate) {
+            flags |= MAP_POPULATE;
+        }
+#   endif
+        void* data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        ::madvise(data, size, MADV_SEQUENTIAL);
+#   if !defined(MAP_POPULATE)
+        if (populate) {
+            ::madvise(data, size, MADV_WILLNEED);
+        }
+#   endif
+        m_data = static_cast<const char*>(data);
+        m_size = size;
+        m_isMapped = true;
+        return true;
+    }
+    // Reads until the end of input; `size` is the expected size, if known.
+    bool read(const int fd, const size_t size) noexcept {
+        try {
+            m_buffer.reserve(size + 1);
+            size_t used = 0;
+            while (true) {
+                if (m_buffer.size() - used < block_size) {
+                    m_buffer.resize(used + block_size);
+                }
+                const ssize_t got = ::read(fd, &m_buffer[used], m_buffer.size() - used);
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got <= 0) {
+                    m_buffer.resize(used);
+                    return got == 0;
+                }
+                used += static_cast<size_t>(got);
+            }
+        }
+        catch (...) {
+            m_buffer.clear();
+            return false;
+        }
+    }
+#else
+    bool read(std::FILE* file) noexcept {
+        try {
+            size_t used = 0;
+            while (true) {
+                m_buffer.resize(used + block_size);
+                const size_t got = std::fread(&m_buffer[used], 1, block_size, file);
+                used += got;
+                if (got < block_size) {
+                    m_buffer.resize(used);
+                    return std::ferror(file) == 0;
+                }
+            }
+        }
+        catch (...) {
+            m_buffer.clear();
+            return false;
+        }
+    }
+#endif
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_buffer;
+    bool m_isOpen = false;
+    bool m_isMapped = false;
+};
+
+// Byte offsets of the rows of a CSV document, for jumping to row N, sampling rows
+// or parsing a range of rows without scanning what comes before. Rows are found with
+// the rules of `parseCSV`, up to `threads` threads at a time like `parseCSV_parallel`.
+// `save` stores the offsets next to the document as LEB128 varints of their deltas,
+// typically 1-2 bytes per row.
+class csv_index {
+public:
+    void build(const checked_string_view csv, const uint32_t threads = 0) {
+        m_size = csv.size();
+        m_offsets.assign(1, 0);
+        const uint32_t count = detail::thread_count(threads, csv.size(), 1 << 20);
+        if (count == 1) {
+            detail::find_csv_rows(csv, 0, csv.size(), false, m_offsets);
+            return;
+        }
+        std::vector<size_t> bounds(count + 1);
+        for (uint32_t i = 0; i <= count; ++i) {
+            bounds[i] = static_cast<size_t>(
+                static_cast<unsigned long long>(csv.size()) * i / count);
+        }
+        std::vector<detail::csv_chunk> chunks(count);
+        detail::parallel_for(count, [&](const uint32_t chunk) {
+            chunks[chunk] = detail::count_csv_rows(csv, bounds[chunk], bounds[chunk + 1]);
+        });
+        std::vector<std::vector<uint64_t>> starts(count);
+        std::vector<char> inQuotes(count);
+        for (uint32_t i = 1; i < count; ++i) {
+            inQuotes[i] = (inQuotes[i - 1] != 0) != chunks[i - 1].isQuoteOdd;
+        }
+        detail::parallel_for(count, [&](const uint32_t chunk) {
+            detail::find_csv_rows(csv, bounds[chunk], bounds[chunk + 1],
+                inQuotes[chunk] != 0, starts[chunk]);
+        });
+        size_t total = 1;
+        for (const std::vector<uint64_t>& chunk : starts) {
+            total += chunk.size();
+        }
+        m_offsets.reserve(total);
+        for (const std::vector<uint64_t>& chunk : starts) {
+            m_offsets.insert(m_offsets.end(), chunk.begin(), chunk.end());
+        }
+    }
+
+    // Same rows as `parseCSV` reports, so an empty document has one empty row.
+    size_t rows() const noexcept {
+        return m_offsets.size();
+    }
+    // Size of the indexed document, to check a loaded index against.
+    uint64_t size() const noexcept {
+        return m_size;
+    }
+    uint64_t offset(const size_t row) const noexcept {
+        return m_offsets[row];
+    }
+    // Rows [first, last) of `csv`, the indexed document, with their row ends, e.g.
+    // for `parseCSV`.
+    std::string_view slice(const checked_string_view csv, const size_t first,
+            const size_t last) const noexcept {
+        if (first >= last || last > m_offsets.size()) {
+            return std::string_view();
+        }
+        const size_t end = last == m_offsets.size() ? csv.size()
+            : static_cast<size_t>(m_offsets[last]);
+        const size_t begin = static_cast<size_t>(m_offsets[first]);
+        return std::string_view(csv.data() + begin, end - begin);
+    }
+    std::string_view row(const checked_string_view csv, const size_t row) const noexcept {
+        return slice(csv, row, row + 1);
+    }
+
+    // Returns false when the file can't be written.
+    bool save(const char* path) const {
+        if (path == nullptr) {
+            return false;
+        }
+        std::string data(magic().data(), magic().size());
+        put_varint(data, m_size);
+        put_varint(data, m_offsets.size());
+        for (size_t i = 1; i < m_offsets.size(); ++i) {
+            put_varint(data, m_offsets[i] - m_offsets[i - 1]);
+        }
+        std::FILE* file = std::fopen(path, "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        const bool isWritten = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        return std::fclose(file) == 0 && isWritten;
+    }
+    // Returns false, leaving the index empty, when the file can't be read or isn't
+    // a saved index.
+    bool load(const char* path) {
+        m_offsets.clear();
+        m_size = 0;
+        mapped_file file(path);
+        const std::string_view data = file.view();
+        if (!file.is_open() || data.substr(0, magic().size()) != magic()) {
+            return false;
+        }
+        size_t pos = magic().size();
+        uint64_t size = 0;
+        uint64_t rows = 0;
+        if (!get_varint(data, pos, size) || !get_varint(data, pos, rows)
+                || rows == 0 || rows - 1 > data.size() - pos) {
+            return false;
+        }
+        m_offsets.reserve(static_cast<size_t>(rows));
+        m_offsets.push_back(0);
+        for (uint64_t i = 1; i < rows; ++i) {
+            uint64_t delta = 0;
+            if (!get_varint(data, pos, delta) || delta == 0
+                    || delta >= size - m_offsets.back()) {
+                m_offsets.clear();
+                return false;
+            }
+            m_offsets.push_back(m_offsets.back() + delta);
+        }
+        m_size = size;
+        return true;
+    }
+
+private:
+    static std::string_view magic() noexcept {
+        return std::string_view("CSVIDX\0\1", 8);
+    }
+
+    static void put_varint(std::string& data, uint64_t value) {
+        while (value >= 0x80) {
+            data.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<char>(value));
+    }
+    static bool get_varint(const std::string_view data, size_t& pos,
+            uint64_t& value) noexcept {
+        value = 0;
+        for (uint32_t shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+            const uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<uint64_t> m_offsets;
+    uint64_t m_size = 0;
+};
+
+// Bases `format_spec` supports.
+enum class format_base : uint8_t {
+    dec = 10,
+    hex = 16,
+};
+
+// How `to_string` writes an integer: in `base`, with upper case hex digits when
+// `upper`, a `+` before non-negative numbers when `sign`, and padded on the left
+// with `fill` to at least `width` characters. Zero fill goes between the sign and
+// the digits, like `%+08d` does. It can be a `constexpr` object, e.g.
+// `constexpr utils::format_spec hex64(utils::format_base::hex, 16, '0');` for `%016llx`.
+struct format_spec {
+    format_base base = format_base::dec;
+    uint8_t width = 0;
+    char fill = ' ';
+    bool upper = false;
+    bool sign = false;
+
+    constexpr format_spec() noexcept {}
+    constexpr explicit format_spec(const format_base numberBase, const uint8_t minWidth = 0,
+            const char fillChar = ' ', const bool isUpper = false,
+            const bool hasSign = false) noexcept
+        : base(numberBase), width(minWidth), fill(fillChar), upper(isUpper), sign(hasSign) {}
+};
+
+namespace detail {
+
+// "00" to "99", for writing two decimal digits at a time.
+inline const char* digit_pairs() noexcept {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    return pairs;
+}
+
+inline uint32_t decimal_digits(const uint64_t value) noexcept {
+    static const uint64_t powers[] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+        100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+        10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+        100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+    };
+    // `| 1` changes no digit count but that of 0, which becomes 1.
+    const uint64_t odd = value | 1;
+    // log10 estimated from log2, off by at most one.
+    const uint32_t log10 = (bsr64(odd) + 1) * 1233 >> 12;
+    return log10 + 1 - (odd < powers[log10] ? 1 : 0);
+}
+
+inline uint32_t hex_digits(const uint64_t value) noexcept {
+    return bsr64(value | 1) / 4 + 1;
+}
+
+// Writes the decimal digits of `value` so that they end at `end`, two at a time.
+inline void write_decimal(uint64_t value, char* end) noexcept {
+    const char* pairs = digit_pairs();
+    while (value >= 100) {
+        const uint32_t pair = static_cast<uint32_t>(value % 100) * 2;
+        value /= 100;
+        end -= 2;
+        end[0] = pairs[pair];
+        end[1] = pairs[pair + 1];
+    }
+    if (value >= 10) {
+        end[-2] = pairs[value * 2];
+        end[-1] = pairs[value * 2 + 1];
+    }
+    else {
+        end[-1] = static_cast<char>('0' + value);
+    }
+}
+
+inline void write_hex(uint64_t value, char* end, const char* digits) noexcept {
+    do {
+        *--end = digits[value & 0x0F];
+        value >>= 4;
+    } while (value != 0);
+}
+
+inline const char* hex_chars(const bool upper) noexcept {
+    return upper ? "0123456789ABCDEF" : "0123456789abcdef";
+}
+
+// Writes `number` as `spec` says in one pass: the digit count is known up front,
+// so padding, sign and digits go in place without a temporary or `snprintf`. With
+// the default spec the output is that of `std::to_chars`. Returns an empty view
+// when `buffer` is too small.
+template<typename integer_t>
+inline std::string_view format_integer(const integer_t number, const std::string_view buffer,
+        const format_spec& spec) noexcept {
+    using unsigned_t = typename std::make_unsigned<integer_t>::type;
+    const bool isNegative = number < 0;
+    uint64_t magnitude = static_cast<unsigned_t>(number);
+    if (isNegative) {
+        magnitude = static_cast<unsigned_t>(0 - static_cast<unsigned_t>(number));
+    }
+    const bool hex = spec.base == format_base::hex;
+    const size_t digits = hex ? hex_digits(magnitude) : decimal_digits(magnitude);
+    const char sign = isNegative ? '-' : spec.sign ? '+' : '\0';
+    const size_t length = digits + (sign != '\0' ? 1 : 0);
+    const size_t size = length < spec.width ? spec.width : length;
+    if (buffer.size() < size) {
+        return {};
+    }
+    char* out = const_cast<char*>(buffer.data());
+    const size_t padding = size - length;
+    if (padding != 0 && spec.fill != '0') {
+        std::memset(out, spec.fill, padding);
+        out += padding;
+    }
+    if (sign != '\0') {
+        *out++ = sign;
+    }
+    if (padding != 0 && spec.fill == '0') {
+        std::memset(out, '0', padding);
+        out += padding;
+    }
+    if (hex) {
+        write_hex(magnitude, out + digits, hex_chars(spec.upper));
+    }
+    else {
+        write_decimal(magnitude, out + digits);
+    }
+    return buffer.substr(0, size);
+}
+template<typename integer_t>
+inline std::string_view format_integer(const integer_t number, const std::string_view buffer,
+        const bool hex) noexcept {
+    return format_integer(number, buffer, format_spec(hex ? format_base::hex : format_base::dec));
+}
+
+// Little-endian load of 8 bytes, which need no alignment.
+inline uint64_t load_le64(const char* p) noexcept {
+    uint64_t value = 0;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+// Whether all 8 bytes of `chunk` are decimal digits.
+inline bool is_eight_digits(const uint64_t chunk) noexcept {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ull)
+        | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))
+        == 0x3333333333333333ull;
+}
+
+// Value of 8 decimal digits, the first in the lowest byte, in three multiplications.
+inline uint32_t parse_eight_digits(uint64_t chunk) noexcept {
+    chunk -= 0x3030303030303030ull;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = ((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))
+        + ((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))) >> 32;
+    return static_cast<uint32_t>(chunk);
+}
+
+// 0-15, or 16 when `c` isn't a hex digit.
+inline uint32_t hex_digit(const char c) noexcept {
+    const uint32_t u = static_cast<uint8_t>(c);
+    if (u - '0' < 10) {
+        return u - '0';
+    }
+    if ((u | 0x20) - 'a' < 6) {
+        return (u | 0x20) - 'a' + 10;
+    }
+    return 16;
+}
+
+// Digits of [begin, end) in base 10 or 16, at least one. Returns false on other
+// bytes and when the value doesn't fit 64 bits.
+inline bool parse_magnitude(const char* begin, const char* const end, const bool hex,
+        uint64_t& magnitude) noexcept {
+    if (begin == end) {
+        return false;
+    }
+    uint64_t value = 0;
+    if (hex) {
+        for (; begin != end; ++begin) {
+            const uint32_t digit = hex_digit(*begin);
+            if (digit > 15 || (value >> 60) != 0) {
+                return false;
             }
-            if (c != 0 && c != '\n' && c != '\r') {
-                isPrevEndl = false;
+            value = value << 4 | digit;
+        }
+        magnitude = value;
+        return true;
+    }
+    for (; end - begin >= 8; begin += 8) {
+        const uint64_t chunk = load_le64(begin);
+        if (!is_eight_digits(chunk)) {
+            break;
+        }
+        const uint64_t digits = parse_eight_digits(chunk);
+        if (value > (UINT64_MAX - digits) / 100000000) {
+            return false;
+        }
+        value = value * 100000000 + digits;
+    }
+    for (; begin != end; ++begin) {
+        const uint32_t digit = static_cast<uint8_t>(*begin) - '0';
+        if (digit > 9 || value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    magnitude = value;
+    return true;
+}
+
+// Stores `magnitude`, negated when `isNegative`, unless it doesn't fit `integer_t`.
+template<typename integer_t>
+inline bool store_integer(const uint64_t magnitude, const bool isNegative,
+        integer_t& number) noexcept {
+    using unsigned_t = typename std::make_unsigned<integer_t>::type;
+    const uint64_t max = static_cast<unsigned_t>(std::numeric_limits<integer_t>::max());
+    if (magnitude > max + (isNegative ? 1 : 0)) {
+        return false;
+    }
+    number = static_cast<integer_t>(isNegative
+        ? static_cast<unsigned_t>(0 - static_cast<unsigned_t>(magnitude))
+        : static_cast<unsigned_t>(magnitude));
+    return true;
+}
+
+// Accepts what `std::from_chars` with base 10 or 16 accepts, all of `string`: a `-`
+// for signed types only, then digits; no `+`, `0x` or whitespace. Reads no byte
+// past `string`, so it needs no NUL terminator. `number` is left as is on failure.
+template<typename integer_t>
+inline bool parse_integer(const std::string_view string, integer_t& number,
+        const bool hex) noexcept {
+    const char* begin = string.data();
+    const char* const end = begin + string.size();
+    const bool isNegative = std::is_signed<integer_t>::value && begin != end && *begin == '-';
+    if (isNegative) {
+        ++begin;
+    }
+    uint64_t magnitude = 0;
+    return parse_magnitude(begin, end, hex, magnitude)
+        && store_integer(magnitude, isNegative, number);
+}
+
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+
+// Field of 1 to 16 bytes gathered by `gather_digits`: with N >= 8, its first and
+// last 8 bytes; with N >= 4, its first and last 4; else bytes 0, N / 2 and N - 1.
+// These `pshufb` masks put the field's bytes at the end of a vector in order and
+// zero the rest, for N in [1, 16].
+inline const uint8_t* right_align_masks() noexcept {
+    static const struct masks {
+        uint8_t bytes[17 * 16] = {};
+        masks() noexcept {
+            for (uint32_t size = 1; size <= 16; ++size) {
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint8_t source = 0x80;
+                    if (i >= 16 - size) {
+                        const uint32_t d = i - (16 - size);
+                        const uint32_t half = size >= 8 ? 8 : size >= 4 ? 4 : 0;
+                        source = static_cast<uint8_t>(half != 0
+                            ? (d < half ? d : half + d - (size - half))
+                            : (d == 0 ? 0 : d == size - 1 ? 2 : 1));
+                    }
+                    bytes[size * 16 + i] = source;
+                }
             }
         }
+    } table;
+    return table.bytes;
+}
+
+// Loads the 1 to 16 bytes at `p` as `right_align_masks` expects, with overlapping
+// loads that stay within them.
+inline __m128i gather_digits(const char* p, const size_t size) noexcept {
+    if (size >= 8) {
+        uint64_t first = 0;
+        uint64_t last = 0;
+        std::memcpy(&first, p, 8);
+        std::memcpy(&last, p + size - 8, 8);
+        return _mm_set_epi64x(static_cast<int64_t>(last), static_cast<int64_t>(first));
+    }
+    if (size >= 4) {
+        uint32_t first = 0;
+        uint32_t last = 0;
+        std::memcpy(&first, p, 4);
+        std::memcpy(&last, p + size - 4, 4);
+        return _mm_set_epi32(0, 0, static_cast<int32_t>(last), static_cast<int32_t>(first));
+    }
+    return _mm_cvtsi32_si128(static_cast<int32_t>(static_cast<uint8_t>(p[0])
+        | static_cast<uint32_t>(static_cast<uint8_t>(p[size / 2])) << 8
+        | static_cast<uint32_t>(static_cast<uint8_t>(p[size - 1])) << 16));
+}
+
+// Value of 1 to 16 decimal digits: they are right-aligned in a vector of zeros and
+// reduced pairwise with `pmaddubsw`, `pmaddwd` and `pmaddwd` again to two 8-digit
+// halves. Returns false on other bytes. Reads nothing past the digits.
+CPP_STRING_UTILS_TARGET("ssse3")
+inline bool parse_sixteen_digits(const char* p, const size_t size,
+        uint64_t& magnitude) noexcept {
+    const __m128i v = _mm_shuffle_epi8(
+        _mm_sub_epi8(gather_digits(p, size), _mm_set1_epi8('0')), _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(right_align_masks() + size * 16)));
+    const __m128i nine = _mm_set1_epi8(9);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, nine), nine)) != 0xFFFF) {
+        return false;
+    }
+    const __m128i pairs = _mm_maddubs_epi16(v,
+        _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    const __m128i quads = _mm_madd_epi16(pairs,
+        _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    const __m128i packed = _mm_packs_epi32(quads, quads);
+    const __m128i halves = _mm_madd_epi16(packed,
+        _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    magnitude = static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(halves)))
+        * 100000000 + static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(halves, 4)));
+    return true;
+}
+
+#endif // CPP_STRING_UTILS_SIMD_X86
+
+// `parse_integer` in base 10, with fields of up to 16 digits reduced with SSSE3
+// when `ssse3`.
+template<typename integer_t>
+inline bool parse_short_integer(const std::string_view string, integer_t& number,
+        const bool ssse3) noexcept {
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    const bool isNegative = std::is_signed<integer_t>::value
+        && !string.empty() && string[0] == '-';
+    const size_t size = string.size() - (isNegative ? 1 : 0);
+    if (ssse3 && size != 0 && size <= 16) {
+        uint64_t magnitude = 0;
+        return parse_sixteen_digits(string.data() + (isNegative ? 1 : 0), size, magnitude)
+            && store_integer(magnitude, isNegative, number);
     }
-    if (!cell.empty()) {
-        onCell(cell, idx);
-        cell.clear();
+#else
+    (void)ssse3;
+#endif
+    return parse_integer(string, number, false);
+}
+
+// Parses each of `strings` into `numbers`, setting failed ones to 0 and their bits
+// in `failures`. Returns the number of failures.
+template<typename integer_t>
+inline size_t parse_integers(const span<const std::string_view> strings,
+        const span<integer_t> numbers, const span<uint64_t> failures) noexcept {
+    for (uint64_t& word : failures) {
+        word = 0;
     }
-    if (!isPrevEndl && onEndl) {
-        onEndl();
+    const size_t count = strings.size() < numbers.size() ? strings.size() : numbers.size();
+    const bool ssse3 = has_ssse3();
+    size_t failed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (parse_short_integer(strings[i], numbers[i], ssse3)) {
+            continue;
+        }
+        numbers[i] = 0;
+        ++failed;
+        if (i / 64 < failures.size()) {
+            failures[i / 64] |= uint64_t(1) << (i % 64);
+        }
     }
+    return failed;
 }
 
+} // namespace detail
+
 #if defined(CPP_STRING_UTILS_LIB_CHARCONV)
 
 template<typename integer_t,
@@ -292,76 +3156,46 @@ inline std::string_view to_string(const integer_t number, const std::string_view
 #else // !CPP_STRING_UTILS_LIB_CHARCONV
 
 inline std::string_view to_string(const int8_t number, const std::string_view buffer) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), "%" PRIi8, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, false);
 }
 inline std::string_view to_string(const uint8_t number, const std::string_view buffer,
         const bool hex = false) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), hex ? "%" PRIx8 : "%" PRIu8, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, hex);
 }
 inline std::string_view to_string(const int16_t number, const std::string_view buffer) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), "%" PRIi16, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, false);
 }
 inline std::string_view to_string(const uint16_t number, const std::string_view buffer,
         const bool hex = false) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), hex ? "%" PRIx16 : "%" PRIu16, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, hex);
 }
 inline std::string_view to_string(const int32_t number, const std::string_view buffer) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), "%" PRIi32, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, false);
 }
 inline std::string_view to_string(const uint32_t number, const std::string_view buffer,
         const bool hex = false) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), hex ? "%" PRIx32 : "%" PRIu32, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, hex);
 }
 inline std::string_view to_string(const int64_t number, const std::string_view buffer) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), "%" PRIi64, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, false);
 }
 inline std::string_view to_string(const uint64_t number, const std::string_view buffer,
         const bool hex = false) noexcept {
-    const int32_t length = std::snprintf(const_cast<char*>(
-        buffer.data()), buffer.size(), hex ? "%" PRIx64 : "%" PRIu64, number);
-    if (length <= 0) {
-        return {};
-    }
-    return buffer.substr(0, length);
+    return detail::format_integer(number, buffer, hex);
 }
 
 #endif // CPP_STRING_UTILS_LIB_CHARCONV
 
+// Writes `number` as `spec` says, see `format_spec`.
+template<typename integer_t,
+    typename std::enable_if<
+        std::is_integral<integer_t>::value && !std::is_same<integer_t, bool>::value, bool
+    >::type = true>
+inline std::string_view to_string(const integer_t number, const std::string_view buffer,
+        const format_spec& spec) noexcept {
+    return detail::format_integer(number, buffer, spec);
+}
+
 #if defined(CPP_STRING_UTILS_LIB_CHARCONV_FLOAT)
 
 template<typename floating_t,
@@ -432,80 +3266,32 @@ inline bool from_string(const checked_string_view string, integer_t& number,
 #else // !CPP_STRING_UTILS_LIB_CHARCONV
 
 inline bool from_string(const checked_string_view string, int8_t& number) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), "%%%u" SCNi8,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, false);
 }
 inline bool from_string(const checked_string_view string, uint8_t& number,
         const bool hex = false) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), hex ? "%%%u" SCNx8 : "%%%u" SCNu8,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, hex);
 }
 inline bool from_string(const checked_string_view string, int16_t& number) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), "%%%u" SCNi16,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, false);
 }
 inline bool from_string(const checked_string_view string, uint16_t& number,
         const bool hex = false) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), hex ? "%%%u" SCNx16 : "%%%u" SCNu16,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, hex);
 }
 inline bool from_string(const checked_string_view string, int32_t& number) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), "%%%u" SCNi32,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, false);
 }
 inline bool from_string(const checked_string_view string, uint32_t& number,
         const bool hex = false) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), hex ? "%%%u" SCNx32 : "%%%u" SCNu32,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, hex);
 }
 inline bool from_string(const checked_string_view string, int64_t& number) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), "%%%u" SCNi64,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, false);
 }
 inline bool from_string(const checked_string_view string, uint64_t& number,
         const bool hex = false) noexcept {
-    char format[8];
-    std::snprintf(format, sizeof(format), hex ? "%%%u" SCNx64 : "%%%u" SCNu64,
-        static_cast<uint32_t>(string.size()));
-    if (std::sscanf(string.data(), format, &number) != 1) {
-        return false;
-    }
-    return true;
+    return detail::parse_integer(string, number, hex);
 }
 
 #endif // CPP_STRING_UTILS_LIB_CHARCONV
@@ -549,6 +3335,713 @@ inline bool from_string(const checked_string_view string, double& number) noexce
 
 #endif // CPP_STRING_UTILS_LIB_CHARCONV_FLOAT
 
+// Parses `strings` in base 10 into `numbers`, like `from_string` on each, but fields
+// of up to 16 digits are reduced with SIMD. Failed fields become 0 and, if `failures`
+// has (size + 63) / 64 words, set their bit there. Returns the number of failures.
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<int8_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<uint8_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<int16_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<uint16_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<int32_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<uint32_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<int64_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+inline size_t from_string(const span<const std::string_view> strings,
+        const span<uint64_t> numbers, const span<uint64_t> failures = span<uint64_t>()) noexcept {
+    return detail::parse_integers(strings, numbers, failures);
+}
+
+// Result of `from_hex`: the bytes written and `npos`, or the position of the first
+// character that isn't a hex digit or of an unpaired last digit, or when the input
+// is valid but `bytes` too small, that of the first digit left out.
+struct hex_result {
+    size_t size;
+    size_t error;
+};
+
+namespace detail {
+
+inline void encode_hex_scalar(const uint8_t* bytes, const size_t size, char* out,
+        const char* chars) noexcept {
+    for (size_t i = 0; i < size; ++i) {
+        out[i * 2] = chars[bytes[i] >> 4];
+        out[i * 2 + 1] = chars[bytes[i] & 0x0F];
+    }
+}
+
+// Decodes `size` pairs of hex digits. Returns the position of the first bad
+// character, or `npos`.
+inline size_t decode_hex_scalar(const char* hex, const size_t size, uint8_t* out) noexcept {
+    for (size_t i = 0; i < size; ++i) {
+        const uint32_t high = hex_digit(hex[i * 2]);
+        const uint32_t low = hex_digit(hex[i * 2 + 1]);
+        if (high > 15) {
+            return i * 2;
+        }
+        if (low > 15) {
+            return i * 2 + 1;
+        }
+        out[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return std::string_view::npos;
+}
+
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+
+// Both kernels look the nibbles up in `chars` with `pshufb` and interleave them;
+// they return the bytes done, a multiple of their block size.
+CPP_STRING_UTILS_TARGET("ssse3")
+inline size_t encode_hex_ssse3(const uint8_t* bytes, const size_t size, char* out,
+        const char* chars) noexcept {
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; size - i >= 16; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        const __m128i high = _mm_shuffle_epi8(table,
+            _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        const __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(v, nibble));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2),
+            _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 16),
+            _mm_unpackhi_epi8(high, low));
+    }
+    return i;
+}
+
+CPP_STRING_UTILS_TARGET("avx2")
+inline size_t encode_hex_avx2(const uint8_t* bytes, const size_t size, char* out,
+        const char* chars) noexcept {
+    const __m256i table = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; size - i >= 32; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+        const __m256i high = _mm256_shuffle_epi8(table,
+            _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        const __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+        // Unpacking works within 128-bit lanes: bytes 0-7 and 16-23, then 8-15 and 24-31.
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2),
+            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2 + 32),
+            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return i;
+}
+
+// Both kernels map digits and letters of either case to nibbles, stop at a block
+// with a bad character and return the bytes done. Pairs of nibbles are combined
+// with `pmaddubsw`.
+CPP_STRING_UTILS_TARGET("ssse3")
+inline size_t decode_hex_ssse3(const char* hex, const size_t size, uint8_t* out) noexcept {
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i five = _mm_set1_epi8(5);
+    const __m128i weights = _mm_set1_epi16(0x0110); // 16 for the first byte, 1 for the second
+    size_t i = 0;
+    for (; size - i >= 16; i += 16) {
+        __m128i nibbles[2];
+        for (uint32_t half = 0; half < 2; ++half) {
+            const __m128i c = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(hex + i * 2 + half * 16));
+            const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+            const __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                _mm_set1_epi8('a'));
+            const __m128i isDigit = _mm_cmpeq_epi8(_mm_max_epu8(digit, nine), nine);
+            const __m128i isLetter = _mm_cmpeq_epi8(_mm_max_epu8(letter, five), five);
+            if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF) {
+                return i;
+            }
+            nibbles[half] = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                _mm_andnot_si128(isDigit, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(
+            _mm_maddubs_epi16(nibbles[0], weights), _mm_maddubs_epi16(nibbles[1], weights)));
+    }
+    return i;
+}
+
+CPP_STRING_UTILS_TARGET("avx2")
+inline size_t decode_hex_avx2(const char* hex, const size_t size, uint8_t* out) noexcept {
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i five = _mm256_set1_epi8(5);
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; size - i >= 32; i += 32) {
+        __m256i nibbles[2];
+        for (uint32_t half = 0; half < 2; ++half) {
+            const __m256i c = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(hex + i * 2 + half * 32));
+            const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+            const __m256i letter = _mm256_sub_epi8(
+                _mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+            const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_max_epu8(digit, nine), nine);
+            const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_max_epu8(letter, five), five);
+            if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)) != -1) {
+                return i;
+            }
+            nibbles[half] = _mm256_blendv_epi8(
+                _mm256_add_epi8(letter, _mm256_set1_epi8(10)), digit, isDigit);
+        }
+        // Packing works within 128-bit lanes, so the quarters come out as 0, 2, 1, 3.
+        const __m256i packed = _mm256_packus_epi16(
+            _mm256_maddubs_epi16(nibbles[0], weights), _mm256_maddubs_epi16(nibbles[1], weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+            _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return i;
+}
+
+#endif // CPP_STRING_UTILS_SIMD_X86
+
+} // namespace detail
+
+// Writes two hex digits per byte into `buffer`. Returns an empty view when it's
+// too small.
+inline std::string_view to_hex(const span<const uint8_t> bytes, const std::string_view buffer,
+        const bool upper = false) noexcept {
+    if (buffer.size() / 2 < bytes.size()) {
+        return {};
+    }
+    char* const out = const_cast<char*>(buffer.data());
+    const char* const chars = detail::hex_chars(upper);
+    size_t done = 0;
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    if (detail::has_avx2()) {
+        done = detail::encode_hex_avx2(bytes.data(), bytes.size(), out, chars);
+    }
+    else if (detail::has_ssse3()) {
+        done = detail::encode_hex_ssse3(bytes.data(), bytes.size(), out, chars);
+    }
+#endif
+    detail::encode_hex_scalar(bytes.data() + done, bytes.size() - done, out + done * 2, chars);
+    return buffer.substr(0, bytes.size() * 2);
+}
+
+// Decodes pairs of hex digits of either case into `bytes`, at most `bytes.size()`
+// of them, stopping at the first bad character. Digits that don't fit are still
+// checked, see `hex_result`.
+inline hex_result from_hex(const checked_string_view hex, const span<uint8_t> bytes) noexcept {
+    size_t size = hex.size() / 2 < bytes.size() ? hex.size() / 2 : bytes.size();
+    size_t done = 0;
+#if defined(CPP_STRING_UTILS_SIMD_X86)
+    if (detail::has_avx2()) {
+        done = detail::decode_hex_avx2(hex.data(), size, bytes.data());
+    }
+    else if (detail::has_ssse3()) {
+        done = detail::decode_hex_ssse3(hex.data(), size, bytes.data());
+    }
+#endif
+    // A block with a bad character is done again here to find it.
+    size_t error = detail::decode_hex_scalar(hex.data() + done * 2, size - done,
+        bytes.data() + done);
+    if (error != std::string_view::npos) {
+        error += done * 2;
+        return { error / 2, error };
+    }
+    for (size_t i = size * 2; i < hex.size(); ++i) {
+        if (detail::hex_digit(hex[i]) > 15) {
+            return { size, i };
+        }
+    }
+    if (hex.size() % 2 != 0) {
+        return { size, hex.size() - 1 };
+    }
+    return { size, size == hex.size() / 2 ? std::string_view::npos : size * 2 };
+}
+
+#if defined(__cpp_lib_byte)
+inline std::string_view to_hex(const span<const std::byte> bytes, const std::string_view buffer,
+        const bool upper = false) noexcept {
+    return to_hex(span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()), buffer, upper);
+}
+inline hex_result from_hex(const checked_string_view hex, const span<std::byte> bytes) noexcept {
+    return from_hex(hex, span<uint8_t>(reinterpret_cast<uint8_t*>(bytes.data()), bytes.size()));
+}
+#endif
+
+// Types `csv_columns` can convert a column to.
+enum class csv_type : uint8_t {
+    int64,
+    float64,
+    string,
+};
+
+// One column read by `csv_columns`: the values of the type it was selected with,
+// one per row, and a bitmap of the rows whose cell is missing or failed to convert
+// (their value is 0 or empty).
+struct csv_column {
+    std::string name; // empty when selected by index
+    uint32_t index = 0;
+    csv_type type = csv_type::string;
+    std::vector<int64_t> ints;
+    std::vector<double> floats;
+    // Views of the input, or of `text` for cells that had to be decoded.
+    std::vector<std::string_view> strings;
+    std::string text;
+    std::vector<uint64_t> failures;
+
+    size_t size() const noexcept {
+        return type == csv_type::int64 ? ints.size()
+            : type == csv_type::float64 ? floats.size() : strings.size();
+    }
+    bool failed(const size_t row) const noexcept {
+        return ((failures[row / 64] >> (row % 64)) & 1) != 0;
+    }
+};
+
+// Reads the selected columns of a CSV document into typed vectors with `from_string`.
+// Cells of other columns are skipped without any conversion. Each column should be
+// selected once.
+class csv_columns {
+public:
+    // Both return the slot of the column for `column()`.
+    size_t select(const uint32_t index, const csv_type type) {
+        csv_column column;
+        column.index = index;
+        column.type = type;
+        m_columns.push_back(std::move(column));
+        return m_columns.size() - 1;
+    }
+    // Needs a header row.
+    size_t select(const checked_string_view name, const csv_type type) {
+        csv_column column;
+        column.name.assign(name.data(), name.size());
+        column.type = type;
+        m_columns.push_back(std::move(column));
+        return m_columns.size() - 1;
+    }
+
+    // Reads the selected columns of `csv`, skipping its first row with cells when
+    // `hasHeader`. Returns false when a column selected by name is not in the header.
+    // String columns may refer to `csv`, which must outlive them.
+    bool read(const checked_string_view csv, const bool hasHeader = true) {
+        for (csv_column& column : m_columns) {
+            column.ints.clear();
+            column.floats.clear();
+            column.strings.clear();
+            column.text.clear();
+            column.failures.clear();
+        }
+        m_rows = 0;
+        std::vector<bool> isFound(m_columns.size());
+        for (size_t i = 0; i < m_columns.size(); ++i) {
+            isFound[i] = m_columns[i].name.empty();
+        }
+        // Decoded string cells are moved into `text`, which may still grow.
+        struct text_cell {
+            size_t slot;
+            size_t row;
+            size_t offset;
+        };
+        std::vector<text_cell> textCells;
+        // As with `csv_dialect::header`, blank lines before the header are dropped.
+        bool isHeader = hasHeader;
+        bool hasHeaderCells = false;
+        if (!isHeader) {
+            map_slots(isFound);
+        }
+        detail::parseCSV(csv,
+            [&](const std::string_view cell, const uint32_t idx) {
+                if (isHeader) {
+                    hasHeaderCells = true;
+                    for (size_t i = 0; i < m_columns.size(); ++i) {
+                        if (!isFound[i] && m_columns[i].name == cell) {
+                            m_columns[i].index = idx;
+                            isFound[i] = true;
+                        }
+                    }
+                    return;
+                }
+                if (idx >= m_slots.size() || m_slots[idx] == 0) {
+                    return;
+                }
+                const size_t slot = m_slots[idx] - 1;
+                csv_column& column = m_columns[slot];
+                bool isOk = true;
+                switch (column.type) {
+                case csv_type::int64:
+                    column.ints.push_back(0);
+                    isOk = from_string(cell, column.ints.back());
+                    break;
+                case csv_type::float64:
+                    column.floats.push_back(0.0);
+                    isOk = from_string(cell, column.floats.back());
+                    break;
+                case csv_type::string:
+                    if (!detail::is_view_of(cell, csv)) {
+                        textCells.push_back({ slot, column.strings.size(), column.text.size() });
+                        column.text.append(cell.data(), cell.size());
+                    }
+                    column.strings.push_back(cell);
+                    break;
+                }
+                if (!isOk) {
+                    set_failed(column, m_rows);
+                }
+            },
+            [&]() {
+                if (isHeader) {
+                    if (hasHeaderCells) {
+                        isHeader = false;
+                        map_slots(isFound);
+                    }
+                    return;
+                }
+                for (csv_column& column : m_columns) {
+                    if (column.size() == m_rows) {
+                        push_missing(column);
+                    }
+                }
+                ++m_rows;
+            });
+        for (const text_cell& cell : textCells) {
+            csv_column& column = m_columns[cell.slot];
+            column.strings[cell.row] = std::string_view(
+                column.text.data() + cell.offset, column.strings[cell.row].size());
+        }
+        bool isComplete = true;
+        for (size_t i = 0; i < m_columns.size(); ++i) {
+            m_columns[i].failures.resize((m_rows + 63) / 64);
+            if (!isFound[i]) {
+                isComplete = false;
+            }
+        }
+        return isComplete;
+    }
+
+    size_t rows() const noexcept {
+        return m_rows;
+    }
+    size_t size() const noexcept {
+        return m_columns.size();
+    }
+    const csv_column& column(const size_t slot) const noexcept {
+        return m_columns[slot];
+    }
+
+private:
+    // Columns selected by a name missing from the header are left out.
+    void map_slots(const std::vector<bool>& isFound) {
+        m_slots.clear();
+        for (size_t i = 0; i < m_columns.size(); ++i) {
+            if (!isFound[i]) {
+                continue;
+            }
+            const uint32_t index = m_columns[i].index;
+            if (m_slots.size() <= index) {
+                m_slots.resize(index + 1);
+            }
+            m_slots[index] = i + 1;
+        }
+    }
+    static void set_failed(csv_column& column, const size_t row) {
+        if (column.failures.size() <= row / 64) {
+            column.failures.resize(row / 64 + 1);
+        }
+        column.failures[row / 64] |= uint64_t(1) << (row % 64);
+    }
+    void push_missing(csv_column& column) {
+        switch (column.type) {
+        case csv_type::int64:
+            column.ints.push_back(0);
+            break;
+        case csv_type::float64:
+            column.floats.push_back(0.0);
+            break;
+        case csv_type::string:
+            column.strings.push_back(std::string_view());
+            break;
+        }
+        set_failed(column, m_rows);
+    }
+
+    std::vector<csv_column> m_columns;
+    std::vector<size_t> m_slots; // by column index: slot + 1, or 0 when not selected
+    size_t m_rows = 0;
+};
+
+namespace detail {
+
+template<bool... values_v>
+struct all_of : std::true_type {};
+template<bool value_v, bool... values_v>
+struct all_of<value_v, values_v...>
+    : std::integral_constant<bool, value_v && all_of<values_v...>::value> {};
+
+// Types `csv_writer` writes with `to_string`: not `bool` nor character types.
+template<typename type_t>
+struct is_csv_number : std::integral_constant<bool,
+    std::is_arithmetic<type_t>::value && !std::is_same<type_t, bool>::value
+    && !std::is_same<type_t, char>::value && !std::is_same<type_t, signed char>::value
+    && !std::is_same<type_t, unsigned char>::value && !std::is_same<type_t, wchar_t>::value
+    && !std::is_same<type_t, char16_t>::value && !std::is_same<type_t, char32_t>::value> {};
+
+// Types `csv_writer::cell` takes: text, numbers and `char`.
+template<typename type_t>
+struct is_csv_cell : std::integral_constant<bool,
+    std::is_convertible<const type_t&, std::string_view>::value
+    || is_csv_number<type_t>::value || std::is_same<type_t, char>::value> {};
+
+// Bytes that make `csv_writer` quote a cell: `dialect_t`'s delimiter and all row
+// ends, so `csv_endl::lf` readers don't drop a trailing `\r` either.
+template<typename dialect_t>
+inline const delimiter_set& csv_specials() noexcept {
+    static const char chars[] = { dialect_t::delimiter, '\n', '\r', '\0' };
+    static const delimiter_set set(chars, sizeof(chars));
+    return set;
+}
+
+// Whether `text` holds special bytes, which need quoting, and whether it holds
+// quotes, which also need doubling. Checks 64 bytes at a time unless it is short.
+template<typename dialect_t>
+inline void scan_csv_cell(const std::string_view text, const bool avx2,
+        bool& needsQuotes, bool& hasQuotes) noexcept {
+    needsQuotes = false;
+    hasQuotes = false;
+    if (text.size() < 16) {
+        for (const char c : text) {
+            hasQuotes |= c == dialect_t::quote;
+            needsQuotes |= csv_specials<dialect_t>().contains(c);
+        }
+        needsQuotes |= hasQuotes;
+        return;
+    }
+    for (size_t base = 0; base < text.size(); base += 64) {
+        uint64_t specials = 0;
+        uint64_t quotes = 0;
+        classify(text.data() + base, text.size() - base, csv_specials<dialect_t>(),
+            dialect_t::quote, avx2, specials, quotes);
+        if (quotes != 0) {
+            needsQuotes = true;
+            hasQuotes = true;
+            return;
+        }
+        needsQuotes |= specials != 0;
+    }
+}
+
+} // namespace detail
+
+// Buffered counterpart of `parseCSV`: cells and row ends are appended to a buffer,
+// which goes to the file descriptor or `FILE` in blocks of `capacity` bytes, and is
+// flushed on destruction. Without a destination the buffer just grows, see `view`.
+// Text cells are quoted only when they hold the delimiter, the quote or a row end
+// (or start a row with the comment char); numbers are written with `to_string`.
+template<typename dialect_t = csv_dialect<>>
+class csv_writer {
+public:
+    static constexpr size_t default_capacity = 1 << 20;
+
+    explicit csv_writer(const size_t capacity = default_capacity)
+        : m_buffer(capacity < 64 ? 64 : capacity, '\0') {}
+#if defined(CPP_STRING_UTILS_POSIX)
+    explicit csv_writer(const int fd, const size_t capacity = default_capacity)
+        : csv_writer(capacity) {
+        m_fd = fd;
+    }
+#endif
+    explicit csv_writer(std::FILE* const file, const size_t capacity = default_capacity)
+        : csv_writer(capacity) {
+        m_file = file;
+    }
+    csv_writer(const csv_writer&) = delete;
+    csv_writer& operator=(const csv_writer&) = delete;
+    ~csv_writer() {
+        flush();
+    }
+
+    csv_writer& cell(const checked_string_view text) {
+        begin_cell();
+        bool needsQuotes = false;
+        bool hasQuotes = false;
+        detail::scan_csv_cell<dialect_t>(text, m_avx2, needsQuotes, hasQuotes);
+        if (dialect_t::comment != 0 && m_idx == 1 && !text.empty()
+                && text[0] == dialect_t::comment) {
+            needsQuotes = true;
+        }
+        // An empty first cell is quoted, or a row holding only it would read as a
+        // blank line.
+        if (m_idx == 1 && text.empty()) {
+            needsQuotes = true;
+        }
+        if (!needsQuotes) {
+            write(text.data(), text.size());
+            return *this;
+        }
+        if (!hasQuotes) {
+            char* out = reserve(text.size() + 2);
+            out[0] = dialect_t::quote;
+            std::memcpy(out + 1, text.data(), text.size());
+            out[text.size() + 1] = dialect_t::quote;
+            m_used += text.size() + 2;
+            return *this;
+        }
+        char* const out = reserve(text.size() * 2 + 2);
+        size_t used = 0;
+        out[used++] = dialect_t::quote;
+        for (size_t begin = 0; begin < text.size(); ) {
+            const void* quote = std::memchr(text.data() + begin, dialect_t::quote,
+                text.size() - begin);
+            const size_t end = quote == nullptr ? text.size()
+                : static_cast<const char*>(quote) - text.data() + 1;
+            std::memcpy(out + used, text.data() + begin, end - begin);
+            used += end - begin;
+            if (quote != nullptr) {
+                out[used++] = dialect_t::quote;
+            }
+            begin = end;
+        }
+        out[used++] = dialect_t::quote;
+        m_used += used;
+        return *this;
+    }
+    template<typename number_t,
+        typename std::enable_if<detail::is_csv_number<number_t>::value, bool>::type = true>
+    csv_writer& cell(const number_t number) {
+        begin_cell();
+        constexpr size_t max_size = 64;
+        char* const out = reserve(max_size);
+        m_used += to_string(number, std::string_view(out, max_size)).size();
+        return *this;
+    }
+    // A `char` is text; `int8_t` and `uint8_t` are neither, cast them to `int`.
+    template<typename char_t,
+        typename std::enable_if<std::is_same<char_t, char>::value, bool>::type = true>
+    csv_writer& cell(const char_t c) {
+        return cell(checked_string_view(&c, 1));
+    }
+    csv_writer& endl() {
+        // Blank lines are skipped by `csv_endl::any`, so a row without cells gets
+        // an empty quoted one.
+        if (m_idx == 0 && dialect_t::endl == csv_endl::any) {
+            const char quotes[] = { dialect_t::quote, dialect_t::quote };
+            write(quotes, 2);
+        }
+        write("\n", 1);
+        m_idx = 0;
+        return *this;
+    }
+
+    // Writes the cells and the row end.
+    csv_writer& row(const span<const std::string_view> cells) {
+        for (const std::string_view text : cells) {
+            cell(text);
+        }
+        return endl();
+    }
+    template<typename... cells_t,
+        typename std::enable_if<
+            detail::all_of<detail::is_csv_cell<cells_t>::value...>::value, bool
+        >::type = true>
+    csv_writer& row(const cells_t&... cells) {
+        const int expand[] = { 0, (cell(cells), 0)... };
+        (void)expand;
+        return endl();
+    }
+
+    // Writes out the buffer. Returns false when this or an earlier write failed;
+    // the failed bytes are dropped.
+    bool flush() {
+        if (m_used != 0 && !is_buffered()) {
+            m_isFailed |= !write_out(m_buffer.data(), m_used);
+            m_used = 0;
+        }
+        return !m_isFailed;
+    }
+    // Contents not written out yet, all of them without a destination.
+    checked_string_view view() const noexcept {
+        return checked_string_view(m_buffer.data(), m_used);
+    }
+    void clear() noexcept {
+        m_used = 0;
+        m_idx = 0;
+    }
+
+private:
+    bool is_buffered() const noexcept {
+#if defined(CPP_STRING_UTILS_POSIX)
+        return m_fd < 0 && m_file == nullptr;
+#else
+        return m_file == nullptr;
+#endif
+    }
+    void begin_cell() {
+        if (m_idx != 0) {
+            *reserve(1) = dialect_t::delimiter;
+            ++m_used;
+        }
+        ++m_idx;
+    }
+    // Room for `size` more bytes, flushing or growing the buffer as needed.
+    char* reserve(const size_t size) {
+        if (m_buffer.size() - m_used < size) {
+            flush();
+            if (m_buffer.size() - m_used < size) {
+                const size_t doubled = m_buffer.size() * 2;
+                m_buffer.resize(doubled < m_used + size ? m_used + size : doubled);
+            }
+        }
+        return &m_buffer[m_used];
+    }
+    void write(const char* data, const size_t size) {
+        std::memcpy(reserve(size), data, size);
+        m_used += size;
+    }
+    bool write_out(const char* data, size_t size) noexcept {
+#if defined(CPP_STRING_UTILS_POSIX)
+        while (m_fd >= 0 && size != 0) {
+            const ssize_t written = ::write(m_fd, data, size);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+#endif
+        if (m_file != nullptr) {
+            return std::fwrite(data, 1, size, m_file) == size;
+        }
+        return true;
+    }
+
+    std::string m_buffer;
+    size_t m_used = 0;
+    uint32_t m_idx = 0; // cells in the current row
+#if defined(CPP_STRING_UTILS_POSIX)
+    int m_fd = -1;
+#endif
+    std::FILE* m_file = nullptr;
+    bool m_avx2 = detail::has_avx2();
+    bool m_isFailed = false;
+};
+
 } // namespace utils
 
 #endif // CPP_STRING_UTILS
@@ -0,0 +1,59 @@
+// Build: g++ -std=c++17 -I.. csv.cpp && ./a.out
+#include "string_utils.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+template<typename dialect_t = utils::csv_dialect<>>
+static std::string parse(const char* csv) {
+    std::string out;
+    utils::parseCSV<dialect_t>(csv,
+        [&](std::string_view cell, uint32_t) {
+            out += '[';
+            out.append(cell.data(), cell.size());
+            out += ']';
+        },
+        [&]() { out += '|'; });
+    return out;
+}
+
+static void header_after_blank_lines() {
+    using with_header = utils::csv_dialect<',', '"', 0, utils::csv_endl::any, true>;
+    assert(parse<with_header>("h1,h2\n1,2\n") == "[1][2]|");
+    assert(parse<with_header>("\nh1\n1\n") == "[1]|");
+    assert(parse<with_header>("\r\n\nh1\n1\n") == "[1]|");
+    using lf_header = utils::csv_dialect<',', '"', 0, utils::csv_endl::lf, true>;
+    assert(parse<lf_header>("\n\nh1\n1\n\n2\n") == "[1]||[2]|");
+}
+
+static void columns_header_after_blank_lines() {
+    utils::csv_columns reader;
+    const size_t price = reader.select("price", utils::csv_type::float64);
+    assert(reader.read("\nid,price\n1,2.5\n"));
+    assert(reader.rows() == 1);
+    assert(reader.column(price).floats[0] == 2.5);
+    assert(!reader.column(price).failed(0));
+}
+
+static void writer_empty_only_cell() {
+    utils::csv_writer<> writer;
+    writer.row("a");
+    writer.row("");
+    writer.row("b");
+    writer.endl();
+    writer.row("", "c");
+    const std::string csv(writer.view().data(), writer.view().size());
+    assert(csv == "a\n\"\"\nb\n\"\"\n\"\",c\n");
+    uint64_t rows = 0;
+    utils::parseCSV(csv, [](std::string_view, uint32_t) {}, [&]() { ++rows; });
+    assert(rows == 5);
+}
+
+int main() {
+    header_after_blank_lines();
+    columns_header_after_blank_lines();
+    writer_empty_only_cell();
+    std::puts("ok");
+    return 0;
+}
@@ -0,0 +1,42 @@
+// Build: g++ -std=c++17 -I.. hex.cpp && ./a.out
+#include "string_utils.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+static void short_buffer() {
+    uint8_t bytes[2] = {};
+    utils::hex_result result = utils::from_hex("deadbeef", bytes);
+    assert(result.size == 2 && result.error == 4); // valid, but "be" is left out
+    assert(bytes[0] == 0xDE && bytes[1] == 0xAD);
+
+    result = utils::from_hex("deadbxef", bytes);
+    assert(result.size == 2 && result.error == 5); // 'x' is checked though not decoded
+
+    result = utils::from_hex("deadb", bytes);
+    assert(result.size == 2 && result.error == 4); // unpaired last digit
+
+    result = utils::from_hex("dead", bytes);
+    assert(result.size == 2 && result.error == std::string_view::npos);
+}
+
+static void long_input() {
+    std::string hex;
+    for (int i = 0; i < 100; ++i) {
+        hex += "0aF9";
+    }
+    uint8_t bytes[200] = {};
+    assert(utils::from_hex(hex, bytes).error == std::string_view::npos);
+    hex[150] = 'g';
+    const utils::hex_result result = utils::from_hex(hex, bytes);
+    assert(result.size == 75 && result.error == 150);
+    assert(utils::from_hex(hex, utils::span<uint8_t>(bytes, 10)).error == 150);
+}
+
+int main() {
+    short_buffer();
+    long_input();
+    std::puts("ok");
+    return 0;
+}
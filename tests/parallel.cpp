@@ -0,0 +1,62 @@
+// Build: g++ -std=c++17 -pthread -I.. parallel.cpp && ./a.out
+#include "string_utils.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+static std::string lines(const uint32_t count) {
+    std::string str;
+    for (uint32_t i = 0; i < count; ++i) {
+        str += "line ";
+        str += std::to_string(i);
+        str += '\n';
+    }
+    return str;
+}
+
+static void rethrows_on_caller() {
+    const std::string str = lines(1 << 20); // about 12 MB, split into 4 chunks
+    for (const uint32_t failing : {0u, (1u << 20) - 1}) {
+        std::atomic<uint32_t> calls(0);
+        bool isThrown = false;
+        try {
+            utils::split_parallel(str, "\n", [&](std::string_view, uint32_t idx) {
+                ++calls;
+                if (idx == failing) {
+                    throw std::runtime_error("part");
+                }
+            }, false, '\\', 4);
+        }
+        catch (const std::runtime_error&) {
+            isThrown = true;
+        }
+        assert(isThrown);
+        assert(calls > 0);
+    }
+}
+
+static void csv_rethrows_on_caller() {
+    const std::string str = lines(1 << 20);
+    bool isThrown = false;
+    try {
+        utils::parseCSV_parallel(str, [&](std::string_view, uint32_t, uint64_t row) {
+            if (row == (1u << 20) - 1) {
+                throw std::runtime_error("cell");
+            }
+        }, nullptr, 4);
+    }
+    catch (const std::runtime_error&) {
+        isThrown = true;
+    }
+    assert(isThrown);
+}
+
+int main() {
+    rethrows_on_caller();
+    csv_rethrows_on_caller();
+    std::puts("ok");
+    return 0;
+}
@@ -0,0 +1,44 @@
+// Build: g++ -std=c++17 -I.. split.cpp && ./a.out
+#include "string_utils.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> parts(const std::string_view str,
+        const utils::delimiter_sequence& by) {
+    std::vector<std::string> result;
+    utils::split(str, by, [&](std::string_view part, uint32_t) {
+        result.emplace_back(part);
+    });
+    return result;
+}
+
+static void escape_led_sequence() {
+    // The sequence starts with the escape char, so nothing is escaped.
+    assert((parts("a\\xb\\xc", utils::delimiter_sequence("\\x"))
+        == std::vector<std::string>{"a", "b", "c"}));
+
+    std::string str;
+    for (int i = 0; i < 100; ++i) {
+        str += "ab\\x";
+    }
+    const std::vector<std::string> result = parts(str, utils::delimiter_sequence("\\x"));
+    assert(result.size() == 100);
+    for (const std::string& part : result) {
+        assert(part == "ab");
+    }
+}
+
+static void escaped_sequence() {
+    assert((parts("a\\->b->c", utils::delimiter_sequence("->"))
+        == std::vector<std::string>{"a\\->b", "c"}));
+}
+
+int main() {
+    escape_led_sequence();
+    escaped_sequence();
+    std::puts("ok");
+    return 0;
+}